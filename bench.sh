@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# Name of the C++ file and output binary
+SRC_FILE="./src/bench.cpp"
+OUT_BIN="bench"
+
+# Additional source files
+LOGGER="./src/dgraph_logger.cpp"
+COMPONENT="./src/components.cpp ./src/encoding.cpp ./src/board.cpp"
+SIM="./src/simulation.cpp ./src/report.cpp"
+LAYER="./src/layers.cpp ./src/layer_cache.cpp"
+MODEL="./src/model.cpp ./src/residency.cpp ./src/networks.cpp"
+
+# Arguments are passed on, e.g. ./bench.sh --sizes 64,128 cnn vgg16
+echo "[*] Compiling $SRC_FILE..."
+g++ -O2 -std=c++17 -pthread -o $OUT_BIN $SRC_FILE $MODEL $SIM $LAYER $COMPONENT $LOGGER
+if [ $? -ne 0 ]; then
+    echo "[!] Compilation failed!"
+    exit 1
+fi
+
+echo "[*] Running benchmarks..."
+mkdir -p results/bench
+./$OUT_BIN "$@" | tee results/bench/bench.txt
@@ -6,9 +6,11 @@ OUT_BIN="main"
 
 # Additional source files
 LOGGER="./src/dgraph_logger.cpp"
-COMPONENT="./src/components.cpp"
-LAYER="./src/layers.cpp"
-MODEL="./src/model.cpp"
+COMPONENT="./src/components.cpp ./src/encoding.cpp ./src/board.cpp"
+SIM="./src/simulation.cpp ./src/bandwidth_solver.cpp ./src/pareto.cpp ./src/report.cpp"
+LAYER="./src/layers.cpp ./src/layer_cache.cpp"
+MODEL="./src/model.cpp ./src/residency.cpp ./src/networks.cpp"
+LOADER="./src/model_loader.cpp ./src/json.cpp"
 
 # Default output image name
 PNG_NAME=${1:-network.png}  # Use first argument, or default to "network.png"
@@ -18,7 +20,7 @@ for size in 32 64 128 256 512 1024; do
         for bw in 16 32 64 128 256 512 1024; do
             # Compile the C++ code
             echo "[*] Compiling $SRC_FILE..."
-            g++ -DCROSSBAR_SIZE=$size -DBIT_PRECISION=$bit -DBANDWIDTH=$bw -std=c++17 -o $OUT_BIN $SRC_FILE $MODEL $LAYER $COMPONENT $LOGGER
+            g++ -DCROSSBAR_SIZE=$size -DBIT_PRECISION=$bit -DBANDWIDTH=$bw -std=c++17 -pthread -o $OUT_BIN $SRC_FILE $MODEL $LOADER $SIM $LAYER $COMPONENT $LOGGER
             if [ $? -ne 0 ]; then
                 echo "[!] Compilation failed!"
                 exit 1
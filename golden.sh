@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# Name of the C++ file and output binary
+SRC_FILE="./src/golden.cpp"
+OUT_BIN="golden"
+
+# Additional source files
+LOGGER="./src/dgraph_logger.cpp"
+COMPONENT="./src/components.cpp ./src/encoding.cpp ./src/board.cpp"
+SIM="./src/simulation.cpp"
+LAYER="./src/layers.cpp ./src/layer_cache.cpp"
+MODEL="./src/model.cpp ./src/residency.cpp ./src/networks.cpp"
+
+# Re-simulates every archived result, ./golden.sh --update pins intended changes
+echo "[*] Compiling $SRC_FILE..."
+g++ -O2 -std=c++17 -pthread -o $OUT_BIN $SRC_FILE $MODEL $SIM $LAYER $COMPONENT $LOGGER
+if [ $? -ne 0 ]; then
+    echo "[!] Compilation failed!"
+    exit 1
+fi
+
+echo "[*] Checking archived results..."
+./$OUT_BIN "$@"
+STATUS=$?
+
+# The bandwidth solver has no archive, every target must be met by a solution
+SOLVER_BIN="golden_solver"
+SOLVER_SRC="./src/main.cpp ./src/bandwidth_solver.cpp ./src/pareto.cpp ./src/report.cpp ./src/model_loader.cpp ./src/json.cpp"
+echo "[*] Compiling the bandwidth solver..."
+g++ -O2 -std=c++17 -pthread -o $SOLVER_BIN $SOLVER_SRC $MODEL $SIM $LAYER $COMPONENT $LOGGER
+if [ $? -ne 0 ]; then
+    echo "[!] Compilation failed!"
+    exit 1
+fi
+
+echo "[*] Checking bandwidth targets..."
+for target in "100" "100 models/mnist_mlp.json" "200 models/residual_block.json"; do
+    OUTPUT=$(./$SOLVER_BIN --target-delay $target)
+    DELAY=$(echo "$OUTPUT" | sed -n 's/^  Delay: \([0-9]*\) unit time$/\1/p')
+    LIMIT=${target%% *}
+    if [ -z "$DELAY" ] || [ "$DELAY" -gt "$LIMIT" ]; then
+        echo "[!] --target-delay $target found no solution:"
+        echo "$OUTPUT"
+        STATUS=1
+    else
+        echo "--target-delay $target: delay $DELAY"
+    fi
+done
+rm -f $SOLVER_BIN
+exit $STATUS
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Name of the C API file and output library
+SRC_FILE="./src/cimsim_c.cpp"
+OUT_LIB="libcimsim.so"
+
+# Additional source files
+LOGGER="./src/dgraph_logger.cpp"
+COMPONENT="./src/components.cpp ./src/encoding.cpp ./src/board.cpp"
+SIM="./src/simulation.cpp"
+LAYER="./src/layers.cpp ./src/layer_cache.cpp"
+MODEL="./src/model.cpp ./src/residency.cpp"
+LOADER="./src/model_loader.cpp ./src/json.cpp"
+
+# Shared library for python/cimsim.py, macros such as -DCHIP_NUM=4 are passed on
+echo "[*] Compiling $OUT_LIB..."
+g++ -O2 -std=c++17 -pthread -shared -fPIC "$@" -o $OUT_LIB $SRC_FILE $MODEL $LOADER $SIM $LAYER $COMPONENT $LOGGER
+if [ $? -ne 0 ]; then
+    echo "[!] Compilation failed!"
+    exit 1
+fi
+echo "[✓] $OUT_LIB built!"
@@ -0,0 +1,194 @@
+import ctypes
+import os
+
+# In-process simulator through libcimsim.so (built by ./libcimsim.sh), see src/cimsim_c.h.
+# CIMSIM_LIB overrides the library path.
+LIB_PATH = os.environ.get('CIMSIM_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'libcimsim.so'))
+
+
+class Config(ctypes.Structure):
+    _fields_ = [
+        ('crossbar_size', ctypes.c_uint32),
+        ('bit_precision', ctypes.c_uint32),
+        ('conv_mapping', ctypes.c_uint32),
+        ('bandwidth', ctypes.c_uint32),
+        ('class_bandwidth', ctypes.c_uint32 * 4),   # CB_ACC, ACC_ACT, IM_CB, LAYER
+    ]
+
+
+_lib = None
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB_PATH):
+            raise RuntimeError(f"{LIB_PATH} not found, build it with ./libcimsim.sh")
+        lib = ctypes.CDLL(LIB_PATH)
+        lib.cim_last_error.restype = ctypes.c_char_p
+        lib.cim_model_parse.restype = ctypes.c_void_p
+        lib.cim_model_parse.argtypes = [ctypes.c_char_p]
+        lib.cim_model_load.restype = ctypes.c_void_p
+        lib.cim_model_load.argtypes = [ctypes.c_char_p]
+        lib.cim_model_free.argtypes = [ctypes.c_void_p]
+        lib.cim_model_name.restype = ctypes.c_char_p
+        lib.cim_model_name.argtypes = [ctypes.c_void_p]
+        lib.cim_model_input.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint32)]
+        lib.cim_default_config.argtypes = [ctypes.POINTER(Config)]
+        lib.cim_evaluate.restype = ctypes.c_int
+        lib.cim_evaluate.argtypes = [ctypes.c_void_p, ctypes.POINTER(Config), ctypes.c_size_t, ctypes.POINTER(ctypes.c_double)]
+        lib.cim_metric_num.restype = ctypes.c_uint32
+        lib.cim_metric_name.restype = ctypes.c_char_p
+        lib.cim_metric_name.argtypes = [ctypes.c_uint32]
+        lib.cim_cache_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64)]
+        lib.cim_simulation_new.restype = ctypes.c_void_p
+        lib.cim_simulation_new.argtypes = [ctypes.c_void_p, ctypes.POINTER(Config)]
+        lib.cim_simulation_free.argtypes = [ctypes.c_void_p]
+        lib.cim_simulation_metrics.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double)]
+        lib.cim_links.restype = ctypes.c_size_t
+        lib.cim_links.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint32 * 3), ctypes.c_size_t]
+        lib.cim_set_bandwidth.restype = ctypes.c_int
+        lib.cim_set_bandwidth.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32]
+        lib.cim_set_sparsity.restype = ctypes.c_int
+        lib.cim_set_sparsity.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_double]
+        lib.cim_update.restype = ctypes.c_int
+        lib.cim_update.argtypes = [ctypes.c_void_p]
+        _lib = lib
+    return _lib
+
+
+def _error():
+    return RuntimeError(_library().cim_last_error().decode())
+
+
+def default_config():
+    config = Config()
+    _library().cim_default_config(ctypes.byref(config))
+    return config
+
+
+def make_config(crossbar_size, bit_precision, bandwidth, conv_mapping=None):
+    """Configuration with one bandwidth on every port and link class, like delay_test.sh"""
+    config = default_config()
+    config.crossbar_size = crossbar_size
+    config.bit_precision = bit_precision
+    config.bandwidth = bandwidth
+    for c in range(4):
+        config.class_bandwidth[c] = bandwidth
+    if conv_mapping is not None:
+        config.conv_mapping = conv_mapping
+    return config
+
+
+class Model:
+    """A JSON model description, from a file or as text"""
+
+    def __init__(self, path=None, json_text=None):
+        lib = _library()
+        self._handle = None
+        if json_text is not None:
+            self._handle = lib.cim_model_parse(json_text.encode())
+        else:
+            self._handle = lib.cim_model_load(path.encode())
+        if not self._handle:
+            raise _error()
+        self.metric_names = [lib.cim_metric_name(i).decode() for i in range(lib.cim_metric_num())]
+
+    def close(self):
+        if self._handle:
+            _library().cim_model_free(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    @property
+    def name(self):
+        return _library().cim_model_name(self._handle).decode()
+
+    @property
+    def input_size(self):
+        size = (ctypes.c_uint32 * 3)()
+        _library().cim_model_input(self._handle, size)
+        return list(size)
+
+    def evaluate(self, configs):
+        """Simulates every configuration, one dict of metrics per configuration"""
+        configs = list(configs)
+        if not configs:
+            return []
+        metric_num = len(self.metric_names)
+        config_array = (Config * len(configs))(*configs)
+        metrics = (ctypes.c_double * (metric_num * len(configs)))()
+        if _library().cim_evaluate(self._handle, config_array, len(configs), metrics) != 0:
+            raise _error()
+        results = []
+        for i in range(len(configs)):
+            row = metrics[i * metric_num:(i + 1) * metric_num]
+            results.append({name: value if name == 'usage' else int(value) for name, value in zip(self.metric_names, row)})
+        return results
+
+    def cache_stats(self):
+        """Entries, lookups and hits of the layer cache shared by all evaluations"""
+        stats = (ctypes.c_uint64 * 3)()
+        _library().cim_cache_stats(self._handle, stats)
+        return list(stats)
+
+
+class Simulation:
+    """One configuration of a model simulated once, then updated after what-if edits"""
+
+    def __init__(self, model, config=None):
+        lib = _library()
+        self._handle = None
+        config = config if config is not None else default_config()
+        self._handle = lib.cim_simulation_new(model._handle, ctypes.byref(config))
+        if not self._handle:
+            raise _error()
+        self.metric_names = model.metric_names
+
+    def close(self):
+        if self._handle:
+            _library().cim_simulation_free(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def metrics(self):
+        """Metrics of the last run, like one result of Model.evaluate()"""
+        values = (ctypes.c_double * len(self.metric_names))()
+        _library().cim_simulation_metrics(self._handle, values)
+        return {name: value if name == 'usage' else int(value) for name, value in zip(self.metric_names, values)}
+
+    def links(self):
+        """(source, destination, bandwidth) of every link in address order"""
+        lib = _library()
+        count = lib.cim_links(self._handle, None, 0)
+        links = (ctypes.c_uint32 * 3 * count)()
+        lib.cim_links(self._handle, links, count)
+        return [tuple(link) for link in links]
+
+    def set_bandwidth(self, source, destination, bandwidth):
+        if _library().cim_set_bandwidth(self._handle, source, destination, bandwidth) != 0:
+            raise _error()
+
+    def set_sparsity(self, tensor, zero_fraction):
+        if _library().cim_set_sparsity(self._handle, tensor.encode(), zero_fraction) != 0:
+            raise _error()
+
+    def update(self):
+        """Simulates the edited layers again, returns how many"""
+        layers = _library().cim_update(self._handle)
+        if layers < 0:
+            raise _error()
+        return layers
+
+
+def sweep(model, crossbar_sizes=(32, 64, 128, 256, 512, 1024), bit_precisions=(1, 4, 8),
+          bandwidths=(16, 32, 64, 128, 256, 512, 1024), conv_mapping=None):
+    """The design grid of delay_test.sh, one dict per point with its configuration and metrics"""
+    points = [(size, bit, bw) for size in crossbar_sizes for bit in bit_precisions for bw in bandwidths]
+    results = model.evaluate(make_config(size, bit, bw, conv_mapping) for size, bit, bw in points)
+    for (size, bit, bw), result in zip(points, results):
+        result.update({'crossbar_size': size, 'bit_precision': bit, 'bandwidth': bw})
+    return results
@@ -1,5 +1,6 @@
 import os
 import re
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
 from collections import defaultdict
@@ -58,6 +59,20 @@ def extract_simulation_data(file_path):
 
     return data if all(val is not None for val in data.values()) else None
 
+def simulate_data(model_file):
+    """Simulate the delay_test.sh grid in-process instead of reading its reports."""
+    import cimsim
+    model = cimsim.Model(model_file)
+    return [{
+        'bandwidth': point['bandwidth'],
+        'delay': point['delay'],
+        'crossbar_size': point['crossbar_size'],
+        'crossbar_amount': point['crossbars'],
+        'bit_precision': point['bit_precision'],
+        'utilization': point['usage'],
+        'total_bits': point['total_bits'],
+    } for point in cimsim.sweep(model)]
+
 def calculate_metric_ranges(data_entries):
     """Automatically determine normalization ranges from data"""
     metrics = ['delay', 'crossbar_size', 'crossbar_amount', 'total_bits']
@@ -190,12 +205,16 @@ def main():
         'bits': 0.2
     }
 
-    for filename in sorted(os.listdir(folder_path)):
-        if filename.endswith(".txt"):
-            file_path = os.path.join(folder_path, filename)
-            data = extract_simulation_data(file_path)
-            if data:
-                data_entries.append(data)
+    # python delay_evaluation.py [model.json] simulates the model through libcimsim.so
+    if len(sys.argv) > 1:
+        data_entries = simulate_data(sys.argv[1])
+    else:
+        for filename in sorted(os.listdir(folder_path)):
+            if filename.endswith(".txt"):
+                file_path = os.path.join(folder_path, filename)
+                data = extract_simulation_data(file_path)
+                if data:
+                    data_entries.append(data)
 
     if not data_entries:
         print("No valid simulation files found!")
@@ -2,6 +2,7 @@ import pandas as pd
 import seaborn as sns
 import matplotlib.pyplot as plt
 import os
+import sys
 import plotly.express as px
 import plotly.graph_objects as go
 import numpy as np
@@ -9,10 +10,25 @@ from matplotlib.colors import LogNorm
 
 # Step 1: List all files in the folder
 folder_path = "./var_network_bw_with_cp_bw/fc/"
-files = [f for f in os.listdir(folder_path) if f.endswith('.txt') or f.endswith('.csv')]
+files = []
+if len(sys.argv) == 1:
+    files = [f for f in os.listdir(folder_path) if f.endswith('.txt') or f.endswith('.csv')]
 
 # Step 2: Parse each file and extract data
 data = []
+if len(sys.argv) > 1:
+    # python delay_heatmap.py [model.json] simulates the grid through libcimsim.so instead
+    import cimsim
+    for point in cimsim.sweep(cimsim.Model(sys.argv[1])):
+        data.append({
+            "Crossbar Size": point['crossbar_size'],
+            "Bit Precision": point['bit_precision'],
+            "Crossbar Amount": point['crossbars'],
+            "Delay": point['delay'],
+            "Usage": point['usage'],
+            "Total Bits": point['total_bits'],
+            "Bandwidth": point['bandwidth']
+        })
 for file in files:
     with open(os.path.join(folder_path, file), 'r') as f:
         content = f.read()
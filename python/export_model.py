@@ -0,0 +1,131 @@
+"""Export a Keras model as a JSON model description for the simulator.
+
+Usage:
+    python export_model.py model.keras [output.json] [--name NAME]
+    python export_model.py --builtin cnn|snn [output.json]
+
+The JSON file can then be simulated with `./main output.json`.
+"""
+import argparse
+import json
+import os
+
+from tensorflow import keras
+from tensorflow.keras import layers
+
+
+def builtin_model(kind):
+    """The networks defined in cnn.py and snn.py, without training them."""
+    if kind == "cnn":
+        return keras.Sequential([
+            layers.Conv2D(32, (3, 3), activation='relu', input_shape=(28, 28, 1)),
+            layers.MaxPooling2D((2, 2)),
+            layers.Conv2D(64, (3, 3), activation='relu'),
+            layers.Flatten(),
+            layers.Dense(64, activation='relu'),
+            layers.Dense(10, activation='softmax')
+        ], name="mnist_cnn")
+    return keras.Sequential([
+        layers.Flatten(input_shape=(28, 28)),
+        layers.Dense(512, activation='relu'),
+        layers.Dense(32, activation='relu'),
+        layers.Dense(10, activation='softmax')
+    ], name="mnist_mlp")
+
+
+def activation_name(layer):
+    act = getattr(layer, "activation", None)
+    return act.__name__ if act is not None else "linear"
+
+
+def conv_pad(layer):
+    if layer.padding == "same":
+        return (layer.kernel_size[0] - 1) // 2
+    return 0
+
+
+def inbound_names(layer):
+    """Names of the Keras layers feeding `layer` (functional models only)."""
+    names = []
+    for node in layer._inbound_nodes:
+        for inbound in node.inbound_layers if isinstance(node.inbound_layers, list) else [node.inbound_layers]:
+            names.append(inbound.name)
+    return names
+
+
+def export(model, name):
+    input_shape = [d for d in model.input_shape[1:]]
+    while len(input_shape) < 3:
+        input_shape.append(1)
+
+    description = {"name": name, "input": input_shape, "layers": []}
+    sequential = isinstance(model, keras.Sequential)
+    # Keras layer name -> simulator tensor name, for layers that only rename a tensor
+    aliases = {l.name: "input" for l in model.layers if isinstance(l, layers.InputLayer)}
+    previous = "input"
+
+    for layer in model.layers:
+        if isinstance(layer, layers.InputLayer):
+            continue
+        sources = [aliases.get(n, n) for n in ([] if sequential else inbound_names(layer))]
+
+        # The host already streams the input as a flat vector
+        if isinstance(layer, layers.Flatten) and not description["layers"]:
+            aliases[layer.name] = "input"
+            continue
+        # Folded into the crossbar weights / activation units
+        if isinstance(layer, (layers.Dropout, layers.BatchNormalization, layers.Activation, layers.ReLU)):
+            aliases[layer.name] = sources[0] if sources else previous
+            continue
+
+        if isinstance(layer, layers.Conv2D):
+            entry = {"type": "Conv", "kernel": list(layer.kernel_size), "filters": layer.filters,
+                     "stride": layer.strides[0], "pad": conv_pad(layer),
+                     "activation": activation_name(layer)}
+        elif isinstance(layer, layers.MaxPooling2D):
+            entry = {"type": "MaxPool", "pool": list(layer.pool_size)}
+        elif isinstance(layer, layers.Flatten):
+            entry = {"type": "Flatten"}
+        elif isinstance(layer, layers.Dense):
+            entry = {"type": "Dense", "units": layer.units, "activation": activation_name(layer)}
+        elif isinstance(layer, layers.Add):
+            entry = {"type": "Add", "inputs": sources}
+        elif isinstance(layer, layers.Concatenate):
+            entry = {"type": "Concat", "inputs": sources}
+        else:
+            raise ValueError(f"Unsupported layer type: {type(layer).__name__}")
+
+        if not sequential:
+            if "inputs" not in entry and sources and sources[0] != previous:
+                entry["input"] = sources[0]
+            entry["name"] = layer.name
+        description["layers"].append(entry)
+        previous = layer.name
+
+    return description
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export a Keras model to the simulator JSON format")
+    parser.add_argument("model", nargs="?", help="saved Keras model (.keras/.h5)")
+    parser.add_argument("output", nargs="?", help="output JSON file")
+    parser.add_argument("--builtin", choices=["cnn", "snn"], help="export the network from cnn.py/snn.py")
+    parser.add_argument("--name", help="model name used for the result directory")
+    args = parser.parse_args()
+
+    if args.builtin:
+        model = builtin_model(args.builtin)
+    elif args.model:
+        model = keras.models.load_model(args.model, compile=False)
+    else:
+        parser.error("give a saved model or --builtin")
+
+    name = args.name or model.name
+    output = args.output or os.path.join("models", f"{name}.json")
+    with open(output, "w") as f:
+        json.dump(export(model, name), f, indent=4)
+    print(f"[✓] {output} written")
+
+
+if __name__ == "__main__":
+    main()
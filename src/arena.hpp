@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "error.hpp"
+
+template <typename T>
+class ArenaArray;
+
+// Per-simulation bump allocator. Objects are placed in large contiguous
+// blocks, never move once created and are all destroyed together.
+class Arena {
+    private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+        size_t used;
+    };
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<Block> blocks;
+    std::vector<Destructor> destructors;
+    size_t block_size;
+    size_t allocated_bytes = 0;
+
+    public:
+    explicit Arena(size_t block_size = 1 << 20): block_size(block_size) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() { clear(); }
+
+    void* allocate(size_t bytes, size_t align) {
+        if (blocks.empty() || !fits(blocks.back(), bytes, align)) {
+            size_t size = std::max(block_size, bytes + align);
+            blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size, 0});
+        }
+        Block& block = blocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t ptr = (base + block.used + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        block.used = ptr - base + bytes;
+        allocated_bytes += bytes;
+        return reinterpret_cast<void*>(ptr);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        destructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+        return object;
+    }
+
+    // Fixed-capacity storage, elements are constructed in place as they are added
+    template <typename T>
+    ArenaArray<T> array(size_t capacity);
+
+    // Destroys every object in reverse creation order and releases the blocks
+    void clear() {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+            it->destroy(it->object);
+        }
+        destructors.clear();
+        blocks.clear();
+        allocated_bytes = 0;
+    }
+
+    size_t getAllocatedBytes() const { return allocated_bytes; }
+
+    private:
+    static bool fits(const Block& block, size_t bytes, size_t align) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t ptr = (base + block.used + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        return ptr - base + bytes <= block.size;
+    }
+};
+
+// View over a contiguous arena allocation. Addresses of the elements stay
+// valid for the lifetime of the arena, so they can be registered directly.
+template <typename T>
+class ArenaArray {
+    private:
+    struct Header {
+        T* data;
+        size_t count;
+        size_t capacity;
+
+        ~Header() {
+            for (size_t i = 0; i < count; i++) data[i].~T();
+        }
+    };
+    Header* header = nullptr;
+
+    friend class Arena;
+
+    public:
+    ArenaArray() = default;
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (!header || header->count == header->capacity) {
+            fail("Arena array over capacity!");
+        }
+        T* element = new (header->data + header->count) T(std::forward<Args>(args)...);
+        header->count++;
+        return *element;
+    }
+
+    // Slots for the next count elements, not counted as added yet. Several
+    // threads can construct disjoint slots in place at once; commit_slots
+    // adds them once every slot is constructed, so a failed fill never
+    // destroys a slot that was not built.
+    T* reserve_slots(size_t count) {
+        if (!header || header->count + count > header->capacity) {
+            fail("Arena array over capacity!");
+        }
+        return header->data + header->count;
+    }
+
+    void commit_slots(size_t count) { header->count += count; }
+
+    T& operator[](size_t index) { return header->data[index]; }
+    T* begin() { return header ? header->data : nullptr; }
+    T* end() { return header ? header->data + header->count : nullptr; }
+    size_t size() const { return header ? header->count : 0; }
+    bool empty() const { return size() == 0; }
+};
+
+template <typename T>
+ArenaArray<T> Arena::array(size_t capacity) {
+    ArenaArray<T> array;
+    T* data = static_cast<T*>(allocate(sizeof(T) * std::max<size_t>(capacity, 1), alignof(T)));
+    array.header = create<typename ArenaArray<T>::Header>();
+    array.header->data = data;
+    array.header->count = 0;
+    array.header->capacity = capacity;
+    return array;
+}
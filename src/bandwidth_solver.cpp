@@ -0,0 +1,103 @@
+#include "bandwidth_solver.hpp"
+#include <numeric>
+
+namespace {
+
+// Smallest value in [low, high] whose bandwidths meet the target, high is known to meet it
+uint32_t searchLowest(uint32_t low, uint32_t high, const std::function<bool(uint32_t)>& meets) {
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (meets(mid)) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return high;
+}
+
+}
+
+BandwidthSolution solveMinBandwidth(const LinkEvaluator& evaluate, uint32_t target, uint32_t max_bandwidth,
+                                    BandwidthTarget kind) {
+    BandwidthSolution solution;
+    auto within = [&](const LinkEvaluation& result) {
+        return (kind == BandwidthTarget::Delay ? result.delay : result.interval) <= target;
+    };
+    auto meets = [&](const ClassBandwidths& bandwidth) {
+        solution.evaluations++;
+        return within(evaluate(bandwidth));
+    };
+
+    ClassBandwidths bandwidth;
+    bandwidth.fill(max_bandwidth);
+    solution.evaluations++;
+    LinkEvaluation full = evaluate(bandwidth);
+    solution.links = full.links;
+    if (!within(full)) {
+        solution.bandwidth = bandwidth;
+        solution.delay = full.delay;
+        solution.interval = full.interval;
+        return solution;
+    }
+    solution.feasible = true;
+
+    // One bandwidth for every link class
+    uint32_t uniform = searchLowest(1, max_bandwidth, [&](uint32_t bw) {
+        ClassBandwidths trial;
+        trial.fill(bw);
+        return meets(trial);
+    });
+    bandwidth.fill(uniform);
+
+    // Then lower the classes one at a time, the class with the most links saves the most.
+    // Lowering a class only adds delay, so a class that cannot go lower now never can.
+    std::array<uint32_t, LINK_CLASS_NUM> order;
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return full.links[a] > full.links[b]; });
+    for (uint32_t c: order) {
+        // A class without links needs no bandwidth, but every simulated one must be positive
+        if (full.links[c] == 0) {
+            bandwidth[c] = 1;
+            continue;
+        }
+        bandwidth[c] = searchLowest(1, bandwidth[c], [&](uint32_t bw) {
+            ClassBandwidths trial = bandwidth;
+            trial[c] = bw;
+            return meets(trial);
+        });
+    }
+
+    solution.evaluations++;
+    LinkEvaluation result = evaluate(bandwidth);
+    solution.delay = result.delay;
+    solution.interval = result.interval;
+    for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) {
+        solution.bandwidth[c] = full.links[c] ? bandwidth[c] : 0;
+        solution.cost += static_cast<uint64_t>(solution.bandwidth[c]) * full.links[c];
+    }
+    return solution;
+}
+
+LinkEvaluator simulationEvaluator(const std::array<uint32_t, 3>& input_size, const std::function<void(Model&)>& build,
+                                  LayerCache* cache) {
+    return [input_size, build, cache](const ClassBandwidths& bandwidth) {
+        bool traced = isTraced();
+        setTrace(false);
+        LinkEvaluation result;
+        {
+            SimConfig config;
+            config.class_bandwidth = bandwidth;
+            Simulation simulation(input_size, "", config, cache);
+            build(simulation.getModel());
+            simulation.getModel().forward();
+            result.delay = simulation.getModel().get_delay();
+            result.interval = simulation.getModel().get_initiation_interval();
+            for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) {
+                result.links[c] = simulation.getInterconnect().getClassLinks(static_cast<LinkClass>(c));
+            }
+        }
+        setTrace(traced);
+        return result;
+    };
+}
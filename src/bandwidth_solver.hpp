@@ -0,0 +1,37 @@
+#pragma once
+#include <functional>
+#include "simulation.hpp"
+
+// Delay of one simulation, its initiation interval and the number of links of every class
+struct LinkEvaluation {
+    uint32_t delay;
+    uint32_t interval;      // see Model::get_initiation_interval()
+    std::array<uint32_t, LINK_CLASS_NUM> links;
+};
+
+// What the target bounds: the end-to-end delay of one input, or the
+// initiation interval for a throughput target
+enum class BandwidthTarget { Delay, Interval };
+
+using LinkEvaluator = std::function<LinkEvaluation(const ClassBandwidths&)>;
+
+struct BandwidthSolution {
+    bool feasible = false;
+    ClassBandwidths bandwidth{};    // 0 for classes without links
+    std::array<uint32_t, LINK_CLASS_NUM> links{};
+    uint32_t delay = 0;
+    uint32_t interval = 0;
+    uint64_t cost = 0;              // provisioned bits per unit time: bandwidth times links, summed over the classes
+    uint32_t evaluations = 0;
+};
+
+// Cheapest per-class bandwidths that keep the delay, or the initiation
+// interval, within target. Neither grows with bandwidth, so every step is a
+// binary search: first for one bandwidth shared by all classes, then for each
+// class on its own, largest class first, until no class can be lowered alone.
+BandwidthSolution solveMinBandwidth(const LinkEvaluator& evaluate, uint32_t target, uint32_t max_bandwidth,
+                                    BandwidthTarget kind = BandwidthTarget::Delay);
+
+// Evaluator that rebuilds the model with build() on a fresh, untraced simulation
+LinkEvaluator simulationEvaluator(const std::array<uint32_t, 3>& input_size, const std::function<void(Model&)>& build,
+                                  LayerCache* cache = nullptr);
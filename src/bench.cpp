@@ -0,0 +1,135 @@
+#include "networks.hpp"
+#include "report.hpp"
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Simulator speed on reference networks. Every model x crossbar size runs in
+// its own process so the peak RSS belongs to that configuration alone.
+//
+// Usage: ./bench [--sizes 32,64,128,256] [--dot] [model ...]
+//        models: mlp cnn lenet5 vgg16 resnet18 (default all)
+
+struct Benchmark {
+    std::string name;
+    std::array<uint32_t, 3> input_size;
+    std::function<void(Model&)> build;
+    uint32_t conv_mapping;
+};
+
+double seconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+void run(const Benchmark& benchmark, uint32_t crossbar_size, bool dot) {
+    std::string name = benchmark.name + "-" + std::to_string(crossbar_size);
+    std::string result_dir = "./results/bench";
+    SimConfig config;
+    config.crossbar_size = crossbar_size;
+    config.conv_mapping = benchmark.conv_mapping;
+    setTrace(false);
+
+    auto start = std::chrono::steady_clock::now();
+    auto* simulation = new Simulation(benchmark.input_size, dot ? result_dir + "/" + name + ".dot" : "", config);
+    benchmark.build(simulation->getModel());
+    auto built = std::chrono::steady_clock::now();
+    simulation->getModel().forward();
+    auto forwarded = std::chrono::steady_clock::now();
+
+    uint32_t crossbars = simulation->getInterconnect().getCrossbarNum();
+    uint64_t packets = simulation->getInterconnect().getPacketNum();
+    if (Board* board = simulation->getBoard()) {
+        crossbars = board->getCrossbarNum();
+        packets = 0;
+        for (uint32_t i = 0; i < board->getChipNum(); i++) packets += board->getChip(i)->getPacketNum();
+    }
+    uint32_t delay = simulation->getModel().get_delay();
+    writeReport(result_dir + "/" + name + ".txt", simulation->getInterconnect(), simulation->getModel(),
+                std::chrono::duration_cast<std::chrono::microseconds>(forwarded - start), simulation->getBoard());
+    delete simulation;
+    auto finished = std::chrono::steady_clock::now();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double forward_s = seconds(forwarded - built);
+    std::cout << std::left << std::setw(10) << benchmark.name << std::right
+              << std::setw(6) << crossbar_size
+              << std::setw(10) << crossbars
+              << std::setw(12) << packets
+              << std::setw(10) << delay
+              << std::fixed << std::setprecision(6)
+              << std::setw(12) << seconds(built - start)
+              << std::setw(12) << forward_s
+              << std::setw(12) << seconds(finished - forwarded)
+              << std::setw(12) << seconds(finished - start)
+              << std::setprecision(0)
+              << std::setw(14) << (forward_s > 0 ? packets / forward_s : 0)
+              << std::setw(12) << usage.ru_maxrss << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const std::vector<Benchmark> benchmarks = {
+        {"mlp", {28, 28, 1}, [](Model& m) { buildMLP(m); }, CONV_MAPPING},
+        {"cnn", {28, 28, 1}, buildCNN, CONV_MAPPING},
+        {"lenet5", {28, 28, 1}, buildLeNet5, CONV_MAPPING},
+        // k2col would unroll the whole 224x224 image into crossbar rows
+        {"vgg16", {224, 224, 3}, buildVGG16, 1},
+        {"resnet18", {224, 224, 3}, buildResNet18, 1},
+    };
+    std::vector<uint32_t> sizes = {32, 64, 128, 256};
+    bool dot = false;
+    std::vector<const Benchmark*> selected;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while (std::getline(list, size, ',')) sizes.push_back(std::stoul(size));
+        } else if (arg == "--dot") {
+            dot = true;
+        } else {
+            auto it = std::find_if(benchmarks.begin(), benchmarks.end(), [&](const Benchmark& b) { return b.name == arg; });
+            if (it == benchmarks.end()) {
+                std::cout << "Unknown benchmark: " << arg << std::endl;
+                exit(1);
+            }
+            selected.push_back(&*it);
+        }
+    }
+    if (selected.empty()) {
+        for (auto& benchmark: benchmarks) selected.push_back(&benchmark);
+    }
+    std::filesystem::create_directories("./results/bench");
+
+    std::cout << std::left << std::setw(10) << "model" << std::right
+              << std::setw(6) << "size"
+              << std::setw(10) << "crossbars"
+              << std::setw(12) << "packets"
+              << std::setw(10) << "delay"
+              << std::setw(12) << "construct_s"
+              << std::setw(12) << "forward_s"
+              << std::setw(12) << "output_s"
+              << std::setw(12) << "wall_s"
+              << std::setw(14) << "packets_per_s"
+              << std::setw(12) << "peak_rss_kb" << std::endl;
+    for (auto* benchmark: selected) {
+        for (uint32_t size: sizes) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                run(*benchmark, size, dot);
+                _exit(0);
+            }
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cout << benchmark->name << "-" << size << " failed!" << std::endl;
+                exit(1);
+            }
+        }
+    }
+    return 0;
+}
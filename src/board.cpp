@@ -0,0 +1,125 @@
+#include "board.hpp"
+
+namespace {
+
+std::string chipDotFile(const std::string& dotFileName, const std::string& suffix) {
+    if (dotFileName.empty()) return dotFileName;
+    size_t dot = dotFileName.rfind(".dot");
+    if (dot == std::string::npos) return dotFileName + suffix;
+    return dotFileName.substr(0, dot) + suffix + ".dot";
+}
+
+}
+
+Board::Board(uint32_t chip_num, uint32_t crossbar_budget, uint32_t link_bw, uint32_t link_latency, const std::string& dotFileName)
+    : crossbar_budget(crossbar_budget), link_bw(link_bw), link_latency(link_latency),
+      logger(chipDotFile(dotFileName, "-links")) {
+    if (chip_num == 0 || chip_num * static_cast<uint64_t>(CHIP_ADDR_SPAN) > std::numeric_limits<uint32_t>::max()) {
+        fail("Unsupported chip number!");
+    }
+    for (uint32_t i = 0; i < chip_num; i++) {
+        std::string file = i == 0 ? dotFileName : chipDotFile(dotFileName, "-chip" + std::to_string(i));
+        chips.emplace_back(new Interconnect(file, i));
+        chips.back()->setBoard(this);
+    }
+}
+
+Interconnect* Board::chipOf(uint32_t addr) {
+    uint32_t index = addr / CHIP_ADDR_SPAN;
+    return index < chips.size() ? chips[index].get() : nullptr;
+}
+
+Component* Board::find(uint32_t addr) {
+    Interconnect* chip = chipOf(addr);
+    Component* component = chip ? chip->getComponent(addr) : nullptr;
+    if (!component) {
+        fail("Cannot find the target component!");
+    }
+    return component;
+}
+
+Interconnect* Board::getChip(uint32_t index) { return chips[index].get(); }
+uint32_t Board::getChipNum() { return chips.size(); }
+
+uint32_t Board::place(Component* component, int layer) {
+    if (crossbar_budget && component->getType() == "Crossbar") {
+        while (chips[current_chip]->getCrossbarNum() >= crossbar_budget) {
+            if (++current_chip == chips.size()) {
+                fail("Model does not fit on ", chips.size(), " chips of ", crossbar_budget, " crossbars!");
+            }
+        }
+    }
+    Interconnect* chip = chips[current_chip].get();
+    component->setInterconnect(chip);
+    return chip->registerLocal(component, layer);
+}
+
+void Board::setBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw) {
+    Interconnect* src_chip = chipOf(src_addr);
+    Interconnect* dest_chip = chipOf(dest_addr);
+    if (src_chip && src_chip == dest_chip) {
+        src_chip->setBandWidth(src_addr, dest_addr, bw);
+        return;
+    }
+    find(src_addr)->addOutPorts(1);
+    find(dest_addr)->addInPorts(1);
+    bandwidth_map[{src_addr, dest_addr}] = bw;
+    link_connections[{src_chip->getChipId(), dest_chip->getChipId()}]++;
+}
+
+uint32_t Board::sendPackets(const Packets& packets) {
+    Component* src = find(packets.source);
+    Component* dest = find(packets.destination);
+    std::pair<uint32_t, uint32_t> link = {chipOf(packets.source)->getChipId(), chipOf(packets.destination)->getChipId()};
+
+    uint32_t size_bits = chipOf(packets.source)->getEncodedSize(packets);
+    uint64_t bits = static_cast<uint64_t>(size_bits) * packets.times;
+    inter_chip_bits += bits;
+    inter_chip_raw_bits += static_cast<uint64_t>(packets.size_bits) * packets.times;
+    inter_chip_transfers += packets.times;
+    link_bits[link] += bits;
+    logger.addEdge(packets.source, src->getType(), packets.destination, dest->getType(), size_bits, packets.times);
+    dest->receive(packets);
+
+    // The physical link is shared by every connection routed over it
+    uint32_t connections = std::max<uint32_t>(link_connections[link], 1);
+    uint32_t bw = std::min({src->getOutPortBW(), dest->getInPortBW(), ceil_div(link_bw, connections)});
+    if (bandwidth_map.find({packets.source, packets.destination}) != bandwidth_map.end()) {
+        bw = std::min(bw, bandwidth_map[{packets.source, packets.destination}]);
+    }
+    return (link_latency + ceil_div(size_bits, bw) * packets.times) * UNIT_TIME;
+}
+
+uint32_t Board::getUsedChipNum() {
+    uint32_t used = 0;
+    for (auto& chip : chips) {
+        if (chip->getCrossbarNum()) used++;
+    }
+    return used;
+}
+
+uint32_t Board::getCrossbarNum() {
+    uint32_t total = 0;
+    for (auto& chip : chips) total += chip->getCrossbarNum();
+    return total;
+}
+
+uint64_t Board::getTotalBits() {
+    uint64_t total = allTimesteps(inter_chip_bits);
+    for (auto& chip : chips) total += chip->getTotalBits();
+    return total;
+}
+
+uint64_t Board::getRawBits() {
+    uint64_t total = allTimesteps(inter_chip_raw_bits);
+    for (auto& chip : chips) total += chip->getRawBits();
+    return total;
+}
+
+uint64_t Board::getInterChipBits() { return allTimesteps(inter_chip_bits); }
+uint64_t Board::getInterChipTransfers() { return allTimesteps(inter_chip_transfers); }
+
+uint64_t Board::getLinkBits(uint32_t src_chip, uint32_t dest_chip) {
+    auto it = link_bits.find({src_chip, dest_chip});
+    return it == link_bits.end() ? 0 : allTimesteps(it->second);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "components.hpp"
+
+// Several chips, each with its own interconnect, joined point to point by
+// slower inter-chip links. Components fill the chips in registration order
+// and spill to the next chip once its crossbar budget is used up.
+class Board {
+    private:
+    std::vector<std::unique_ptr<Interconnect>> chips;
+    uint32_t crossbar_budget;   // 0-unlimited
+    uint32_t link_bw;
+    uint32_t link_latency;
+    uint32_t current_chip = 0;
+    DotGraphLogger logger;
+
+    std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t, pair_hash> bandwidth_map;   // cross-chip connections
+    std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t, pair_hash> link_connections;  // connections sharing a chip-to-chip link
+    std::unordered_map<std::pair<uint32_t, uint32_t>, uint64_t, pair_hash> link_bits;
+    uint64_t inter_chip_bits = 0;
+    uint64_t inter_chip_raw_bits = 0;
+    uint64_t inter_chip_transfers = 0;
+
+    Interconnect* chipOf(uint32_t addr);
+    Component* find(uint32_t addr);
+
+    public:
+    Board(uint32_t chip_num, uint32_t crossbar_budget, uint32_t link_bw, uint32_t link_latency, const std::string& dotFileName);
+
+    // Chip 0 is the entry point, the host and the first layers live there
+    Interconnect* getChip(uint32_t index);
+    uint32_t getChipNum();
+
+    uint32_t place(Component* component, int layer);
+    void setBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw);
+    uint32_t sendPackets(const Packets& packets);
+
+    uint32_t getUsedChipNum();
+    uint32_t getCrossbarNum();
+    uint64_t getTotalBits();
+    uint64_t getRawBits();
+    uint64_t getInterChipBits();
+    uint64_t getInterChipTransfers();
+    uint64_t getLinkBits(uint32_t src_chip, uint32_t dest_chip);
+};
@@ -0,0 +1,253 @@
+#include "cimsim_c.h"
+#include "model_loader.hpp"
+#include "simulation.hpp"
+#include "error.hpp"
+
+struct CimModel {
+    ModelDescription description;
+    LayerCache cache;
+};
+
+// Tracked runs bypass the layer cache, so the simulation needs none
+struct CimSimulation {
+    std::unique_ptr<Simulation> simulation;
+};
+
+static_assert(LINK_CLASS_NUM == 4, "CimConfig.class_bandwidth and the link metrics list every link class");
+
+// Message of the last failed call on this thread
+static thread_local std::string last_error;
+
+static const char* metric_names[CIM_METRIC_NUM] = {
+    "delay", "crossbars", "usage", "min_bandwidth", "total_bits", "raw_bits", "packets",
+    "cb_acc_links", "acc_act_links", "im_cb_links", "layer_links"
+};
+
+static SimConfig toSimConfig(const CimConfig& config) {
+    SimConfig sim_config;
+    sim_config.crossbar_size = config.crossbar_size;
+    sim_config.bit_precision = config.bit_precision;
+    sim_config.conv_mapping = config.conv_mapping;
+    sim_config.bandwidth = config.bandwidth;
+    for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) sim_config.class_bandwidth[c] = config.class_bandwidth[c];
+    return sim_config;
+}
+
+// Same totals as writeReport(), over all chips of a board
+static void collectMetrics(Simulation& simulation, double* metrics) {
+    std::vector<Interconnect*> chips = {&simulation.getInterconnect()};
+    Board* board = simulation.getBoard();
+    if (board) {
+        chips.clear();
+        for (uint32_t i = 0; i < board->getChipNum(); i++) chips.push_back(board->getChip(i));
+    }
+    uint32_t crossbar_num = 0, min_bandwidth = 0;
+    double valid_area = 0;
+    uint64_t packets = 0;
+    uint32_t links[LINK_CLASS_NUM] = {};
+    for (auto* chip: chips) {
+        crossbar_num += chip->getCrossbarNum();
+        if (chip->getCrossbarNum()) valid_area += chip->getCrossbarUsage() * chip->getCrossbarNum();
+        min_bandwidth = std::max(min_bandwidth, chip->getMinBandwidth());
+        packets += chip->getPacketNum();
+        for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) links[c] += chip->getClassLinks(static_cast<LinkClass>(c));
+    }
+
+    metrics[CIM_DELAY] = simulation.getModel().get_delay();
+    metrics[CIM_CROSSBARS] = crossbar_num;
+    metrics[CIM_USAGE] = crossbar_num ? valid_area / crossbar_num : 0;
+    metrics[CIM_MIN_BANDWIDTH] = min_bandwidth;
+    metrics[CIM_TOTAL_BITS] = board ? board->getTotalBits() : simulation.getInterconnect().getTotalBits();
+    metrics[CIM_RAW_BITS] = board ? board->getRawBits() : simulation.getInterconnect().getRawBits();
+    metrics[CIM_PACKETS] = packets;
+    metrics[CIM_CB_ACC_LINKS] = links[CB_ACC];
+    metrics[CIM_ACC_ACT_LINKS] = links[ACC_ACT];
+    metrics[CIM_IM_CB_LINKS] = links[IM_CB];
+    metrics[CIM_LAYER_LINKS] = links[LAYER];
+}
+
+const char* cim_last_error(void) {
+    return last_error.c_str();
+}
+
+CimModel* cim_model_parse(const char* json) {
+    ThrowErrors throwing;
+    try {
+        if (!json) fail("No model description!");
+        return new CimModel{parseModelDescription(parseJson(json)), LayerCache()};
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        return nullptr;
+    } catch (...) {
+        last_error = "Unknown error";
+        return nullptr;
+    }
+}
+
+CimModel* cim_model_load(const char* filename) {
+    ThrowErrors throwing;
+    try {
+        if (!filename) fail("No model file!");
+        return new CimModel{loadModelDescription(filename), LayerCache()};
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        return nullptr;
+    } catch (...) {
+        last_error = "Unknown error";
+        return nullptr;
+    }
+}
+
+void cim_model_free(CimModel* model) {
+    delete model;
+}
+
+const char* cim_model_name(const CimModel* model) {
+    return model ? model->description.name.c_str() : "";
+}
+
+void cim_model_input(const CimModel* model, uint32_t input_size[3]) {
+    for (uint32_t i = 0; i < 3; i++) input_size[i] = model ? model->description.input_size[i] : 0;
+}
+
+void cim_default_config(CimConfig* config) {
+    SimConfig defaults;
+    config->crossbar_size = defaults.crossbar_size;
+    config->bit_precision = defaults.bit_precision;
+    config->conv_mapping = defaults.conv_mapping;
+    config->bandwidth = defaults.bandwidth;
+    for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) config->class_bandwidth[c] = defaults.class_bandwidth[c];
+}
+
+int cim_evaluate(CimModel* model, const CimConfig* configs, size_t count, double* metrics) {
+    ThrowErrors throwing;
+    bool traced = isTraced();
+    setTrace(false);
+    try {
+        if (!model) fail("No model handle!");
+        for (size_t i = 0; i < count; i++) {
+            Simulation simulation(model->description.input_size, "", toSimConfig(configs[i]), &model->cache);
+            buildModel(model->description, simulation.getModel());
+            simulation.getModel().forward();
+            collectMetrics(simulation, metrics + i * CIM_METRIC_NUM);
+        }
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        setTrace(traced);
+        return -1;
+    } catch (...) {
+        last_error = "Unknown error";
+        setTrace(traced);
+        return -1;
+    }
+    setTrace(traced);
+    return 0;
+}
+
+uint32_t cim_metric_num(void) {
+    return CIM_METRIC_NUM;
+}
+
+const char* cim_metric_name(uint32_t metric) {
+    return metric < CIM_METRIC_NUM ? metric_names[metric] : "";
+}
+
+void cim_cache_stats(CimModel* model, uint64_t stats[3]) {
+    stats[0] = model ? model->cache.size() : 0;
+    stats[1] = model ? model->cache.getLookups() : 0;
+    stats[2] = model ? model->cache.getHits() : 0;
+}
+
+CimSimulation* cim_simulation_new(const CimModel* model, const CimConfig* config) {
+    ThrowErrors throwing;
+    bool traced = isTraced();
+    setTrace(false);
+    try {
+        if (!model || !config) fail("No model handle or configuration!");
+        auto simulation = std::make_unique<Simulation>(model->description.input_size, "", toSimConfig(*config));
+        simulation->getInterconnect().setTracking(true);
+        buildModel(model->description, simulation->getModel());
+        simulation->getModel().forward();
+        setTrace(traced);
+        return new CimSimulation{std::move(simulation)};
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        setTrace(traced);
+        return nullptr;
+    } catch (...) {
+        last_error = "Unknown error";
+        setTrace(traced);
+        return nullptr;
+    }
+}
+
+void cim_simulation_free(CimSimulation* simulation) {
+    delete simulation;
+}
+
+void cim_simulation_metrics(CimSimulation* simulation, double* metrics) {
+    if (simulation) {
+        collectMetrics(*simulation->simulation, metrics);
+    } else {
+        std::fill(metrics, metrics + CIM_METRIC_NUM, 0.0);
+    }
+}
+
+size_t cim_links(CimSimulation* simulation, uint32_t (*links)[3], size_t capacity) {
+    if (!simulation) return 0;
+    auto all = simulation->simulation->getInterconnect().getLinks();
+    for (size_t i = 0; i < all.size() && i < capacity; i++) {
+        std::tie(links[i][0], links[i][1], links[i][2]) = all[i];
+    }
+    return all.size();
+}
+
+int cim_set_bandwidth(CimSimulation* simulation, uint32_t source, uint32_t destination, uint32_t bandwidth) {
+    ThrowErrors throwing;
+    try {
+        if (!simulation) fail("No simulation handle!");
+        simulation->simulation->getInterconnect().updateBandWidth(source, destination, bandwidth);
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        return -1;
+    } catch (...) {
+        last_error = "Unknown error";
+        return -1;
+    }
+    return 0;
+}
+
+int cim_set_sparsity(CimSimulation* simulation, const char* tensor, double zero_fraction) {
+    ThrowErrors throwing;
+    try {
+        if (!simulation) fail("No simulation handle!");
+        simulation->simulation->getModel().set_sparsity(tensor, zero_fraction);
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        return -1;
+    } catch (...) {
+        last_error = "Unknown error";
+        return -1;
+    }
+    return 0;
+}
+
+int cim_update(CimSimulation* simulation) {
+    ThrowErrors throwing;
+    bool traced = isTraced();
+    setTrace(false);
+    try {
+        if (!simulation) fail("No simulation handle!");
+        int layers = static_cast<int>(simulation->simulation->getModel().update());
+        setTrace(traced);
+        return layers;
+    } catch (const std::exception& error) {
+        last_error = error.what();
+        setTrace(traced);
+        return -1;
+    } catch (...) {
+        last_error = "Unknown error";
+        setTrace(traced);
+        return -1;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain C interface of the simulator, built into libcimsim.so by libcimsim.sh
+// for in-process use from other languages (see python/cimsim.py). Calls that
+// fail on an invalid model or configuration return NULL or -1 and leave the
+// reason in cim_last_error(). A NULL handle fails those calls the same way;
+// the getters then give an empty name, zeros or no links.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct CimModel CimModel;
+typedef struct CimSimulation CimSimulation;
+
+// Mirrors SimConfig
+typedef struct {
+    uint32_t crossbar_size;
+    uint32_t bit_precision;
+    uint32_t conv_mapping;
+    uint32_t bandwidth;
+    uint32_t class_bandwidth[4];    // CB_ACC, ACC_ACT, IM_CB, LAYER
+} CimConfig;
+
+// Values cim_evaluate() returns for every configuration, in this order
+enum CimMetric {
+    CIM_DELAY,
+    CIM_CROSSBARS,
+    CIM_USAGE,
+    CIM_MIN_BANDWIDTH,
+    CIM_TOTAL_BITS,
+    CIM_RAW_BITS,
+    CIM_PACKETS,
+    CIM_CB_ACC_LINKS,
+    CIM_ACC_ACT_LINKS,
+    CIM_IM_CB_LINKS,
+    CIM_LAYER_LINKS,
+    CIM_METRIC_NUM
+};
+
+// Message of the last failed call on the calling thread
+const char* cim_last_error(void);
+
+// A model description in the JSON format of models/, as text or as a file.
+// NULL if it cannot be read or is invalid.
+CimModel* cim_model_parse(const char* json);
+CimModel* cim_model_load(const char* filename);
+void cim_model_free(CimModel* model);
+
+// Name of the model and its [height, width, channel] input
+const char* cim_model_name(const CimModel* model);
+void cim_model_input(const CimModel* model, uint32_t input_size[3]);
+
+// The compiled-in defaults of configuration.hpp
+void cim_default_config(CimConfig* config);
+
+// Simulates the model once per configuration. metrics receives CIM_METRIC_NUM
+// values per configuration, one row after another. Layer results are cached
+// in the model handle and shared by all later calls. Returns 0, or -1 if a
+// configuration cannot be simulated.
+int cim_evaluate(CimModel* model, const CimConfig* configs, size_t count, double* metrics);
+
+uint32_t cim_metric_num(void);
+const char* cim_metric_name(uint32_t metric);
+
+// Layer cache of the handle: entries, lookups and hits
+void cim_cache_stats(CimModel* model, uint64_t stats[3]);
+
+// One configuration of the model simulated once and kept for what-if edits.
+// cim_update() simulates again only the layers the edits since the last run
+// touched. Independent of the model handle once created, single chip only.
+// NULL if the configuration cannot be simulated.
+CimSimulation* cim_simulation_new(const CimModel* model, const CimConfig* config);
+void cim_simulation_free(CimSimulation* simulation);
+
+// CIM_METRIC_NUM values of the last run, as cim_evaluate() gives them
+void cim_simulation_metrics(CimSimulation* simulation, double* metrics);
+
+// Links of the simulation in address order, the first capacity of them as
+// source, destination and bandwidth. Returns the number of links.
+size_t cim_links(CimSimulation* simulation, uint32_t (*links)[3], size_t capacity);
+
+// Edits for the next cim_update(): the bandwidth of an existing link, and the
+// output sparsity of the layer producing a tensor. Return 0, or -1.
+int cim_set_bandwidth(CimSimulation* simulation, uint32_t source, uint32_t destination, uint32_t bandwidth);
+int cim_set_sparsity(CimSimulation* simulation, const char* tensor, double zero_fraction);
+
+// Applies the edits, returns the number of layers simulated again, or -1
+int cim_update(CimSimulation* simulation);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,14 +1,78 @@
 #include "components.hpp"
+#include "board.hpp"
+#include "parallel.hpp"
+#include <sstream>
 
 uint32_t ceil_div(uint32_t a, uint32_t b) {
     return (a + b - 1) / b;
 }
 
+// Only one timestep is simulated, every later one repeats its sends
+uint64_t allTimesteps(uint64_t count) {
+    return count * std::max<uint64_t>(SNN_TIMESTEPS, 1);
+}
+
+namespace {
+bool trace_enabled = true;
+thread_local std::ostream null_stream(nullptr);   // per thread, the trace still sets its format flags
+
+// Edge of the network graph, kept until the sends of all workers are done
+struct LoggedEdge {
+    uint32_t from;
+    std::string from_type;
+    uint32_t to;
+    std::string to_type;
+    uint32_t size_bits, times, delay;
+};
+
+// Counters of one worker of Interconnect::parallelSends(), with its part of
+// the trace and of the network graph in send order
+struct WorkerTraffic {
+    TrafficTotals totals;
+    uint64_t packet_num = 0;
+    CriticalSend slowest;
+    std::ostringstream trace;
+    std::vector<LoggedEdge> edges;
+};
+thread_local WorkerTraffic* worker_traffic = nullptr;
+}
+
+std::ostream& trace() {
+    if (!trace_enabled) return null_stream;
+    return worker_traffic ? worker_traffic->trace : std::cout;
+}
+void setTrace(bool enable) { trace_enabled = enable; }
+bool isTraced() { return trace_enabled; }
+
 Packet::Packet(uint32_t src, uint32_t dest, uint32_t size)
     : source(src), destination(dest), size_bits(size) {}
 
-Packets::Packets(uint32_t src, uint32_t dest, uint32_t size, uint32_t times)
-    : source(src), destination(dest), size_bits(size), times(times) {}
+Packets::Packets(uint32_t src, uint32_t dest, uint32_t size, uint32_t times, double density)
+    : source(src), destination(dest), size_bits(size), times(times), density(density) {}
+
+MulticastPackets::MulticastPackets(uint32_t src, uint32_t size, uint32_t times, double density)
+    : source(src), size_bits(size), times(times), density(density) {}
+
+// Components never have address 0, so a send without a source is an empty probe
+void CriticalSend::add(const CriticalSend& other) {
+    if (!other.source) return;
+    if (!source) {
+        *this = other;
+    } else if (other.source == source && other.destination == destination) {
+        time = std::max(time, other.time);
+        bits = std::max(bits, other.bits);
+        runner_up = std::max(runner_up, other.runner_up);
+        has_runner_up = has_runner_up || other.has_runner_up;
+    } else if (other.time > time) {
+        uint32_t previous = std::max(time, runner_up);
+        *this = other;
+        runner_up = std::max(runner_up, previous);
+        has_runner_up = true;
+    } else {
+        runner_up = std::max({runner_up, other.time, other.runner_up});
+        has_runner_up = true;
+    }
+}
 
 // Generic Component class
 Component::Component(uint32_t size, Interconnect* ic)
@@ -19,26 +83,36 @@ Component::Component(uint32_t size, Interconnect* ic)
 }
 
 void Component::setAddr(uint32_t addr) { address = addr; }
+void Component::setInterconnect(Interconnect* ic) { interconnect = ic; }
     
 // Can be overided if needed
 void Component::receive(Packet packet) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received packet from 0x" << packet.source 
                 << " | Packet Size: " << std::dec << packet.size_bits 
                 << " bits\n";
 }
 void Component::receive(Packets packets) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received packets from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
                 << " bits\n";
 }
 
 uint32_t Interconnect::registerComponent(Component* component) {
+    if (board) {
+        return board->place(component, owner);
+    }
+    return registerLocal(component, owner);
+}
+
+uint32_t Interconnect::registerLocal(Component* component, int layer) {
     uint32_t addr = next_addr;
     next_addr += UNIT_ADDR;
     component->setAddr(addr);
     address_map[addr] = component;
+    if (tracking) owners[addr] = owner;
+    if (logger.isEnabled()) logger.addComponent(addr, component->getType(), layer);
     if (component->getType() == "Crossbar") {
         crossbar_num++;
         CIMCrossbar* crossbar = dynamic_cast<CIMCrossbar*>(component);
@@ -48,16 +122,37 @@ uint32_t Interconnect::registerComponent(Component* component) {
 }
 
 void Interconnect::setBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw) {
+    if (replaying) return;
+    if (routed(src_addr, dest_addr)) {
+        // One link per source into the buffer and one per target out of it
+        uint32_t buffer_addr = route_buffer->getAddress();
+        route_fanout[src_addr]++;
+        if (!bandwidth_map.count({src_addr, buffer_addr})) setBandWidth(src_addr, buffer_addr, bw);
+        if (!bandwidth_map.count({buffer_addr, dest_addr})) setBandWidth(buffer_addr, dest_addr, bw);
+        return;
+    }
     if (address_map.find(src_addr) != address_map.end() && address_map.find(dest_addr) != address_map.end()) {
         this->bandwidth_map[{src_addr, dest_addr}] = bw;
         address_map[src_addr]->addOutPorts(1);
         address_map[dest_addr]->addInPorts(1);
+    } else if (board) {
+        board->setBandWidth(src_addr, dest_addr, bw);
     } else {
-        std::cout << "Cannot find the target component!" << std::endl;
-        exit(1);
+        fail("Cannot find the target component!");
     }
 }
 
+void Interconnect::setBandWidth(uint32_t src_addr, uint32_t dest_addr, LinkClass link_class) {
+    if (replaying) return;
+    setBandWidth(src_addr, dest_addr, config.class_bandwidth[link_class]);
+    class_links[link_class]++;
+}
+
+uint32_t Interconnect::getClassLinks(LinkClass link_class) { return class_links[link_class]; }
+
+void Interconnect::setConfig(const SimConfig& sim_config) { config = sim_config; }
+const SimConfig& Interconnect::getConfig() { return config; }
+
 uint32_t Interconnect::getBandWidth(uint32_t src_addr, uint32_t dest_addr) {
     if (this->bandwidth_map.find({src_addr, dest_addr}) != this->bandwidth_map.end()) {
         return this->bandwidth_map[{src_addr, dest_addr}];
@@ -66,6 +161,13 @@ uint32_t Interconnect::getBandWidth(uint32_t src_addr, uint32_t dest_addr) {
     }
 }
 
+std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> Interconnect::getLinks() {
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> links;
+    for (auto& [link, bw]: bandwidth_map) links.emplace_back(link.first, link.second, bw);
+    std::sort(links.begin(), links.end());
+    return links;
+}
+
 uint32_t Component::send(uint32_t dest) {
     Packet packet(address, dest, size_bits);
     return interconnect->sendPacket(packet);
@@ -75,10 +177,16 @@ uint32_t Component::send(uint32_t dest, uint32_t size) {
     return interconnect->sendPacket(packet);
 }
 uint32_t Component::send(uint32_t dest, uint32_t size, uint32_t times) {
-    Packets packets(address, dest, size, times);
+    Packets packets(address, dest, size, times, output_density);
     return interconnect->sendPackets(packets);
 }
 
+uint32_t Component::multicast(const std::vector<uint32_t>& dests, uint32_t size, uint32_t times) {
+    MulticastPackets packets(address, size, times, output_density);
+    packets.destinations = dests;
+    return interconnect->sendMulticast(packets);
+}
+
 uint32_t Component::getAddress() { return address; }
 uint32_t Component::getSize() { return size_bits; }
 
@@ -98,9 +206,23 @@ uint32_t Component::getOutPortBW() {
     }
 }
 
+void Component::setSparsity(double zero_fraction) {
+    if (zero_fraction < 0 || zero_fraction >= 1) {
+        fail("Sparsity must be in [0, 1)!");
+    }
+    output_density = 1.0 - zero_fraction;
+}
+
+void Component::setPlanes(uint32_t bit_planes) { planes = bit_planes; }
+uint32_t Component::getPlanes() { return planes ? planes : interconnect->getPlanes(); }
+
 uint32_t Component::getInPortNum() { return in_port_num; }
 uint32_t Component::getOutPortNum(){ return out_port_num; }
 
+uint32_t Component::getOutPortShare(uint32_t ports) {
+    return ceil_div(out_port_bw, ports);
+}
+
 uint32_t Component::addInPorts(uint32_t port_num) {
     in_port_num += port_num;
     return in_port_num;
@@ -114,74 +236,365 @@ uint32_t Component::addOutPorts(uint32_t port_num) {
 std::string Component::getType() { return "Not defined!"; }
 
 // Interconnect model
-Interconnect::Interconnect(const std::string& dotFileName)
-    : logger(dotFileName) {}
+Interconnect::Interconnect(const std::string& dotFileName, uint32_t chip_id)
+    : logger(dotFileName, DOT_SUMMARY), encoding(makeLinkEncoding(SNN_TIMESTEPS && !LINK_ENCODING ? 4 : LINK_ENCODING)), chip_id(chip_id) {
+    next_addr = chip_id * CHIP_ADDR_SPAN + UNIT_ADDR;
+}
 
 uint32_t Interconnect::registerComponent(Component* component);
 
 uint32_t Interconnect::sendPacket(const Packet& packet) {
-    if (address_map.find(packet.destination) != address_map.end()) {
-        if (address_map.find(packet.destination)->second->getType() != "Im2col" && min_bandwidth < packet.size_bits) {
-            min_bandwidth = packet.size_bits;
-        }
+    if (routed(packet.source, packet.destination)) {
+        return sendPackets(Packets(packet.source, packet.destination, packet.size_bits, 1));
+    }
+    auto dest = address_map.find(packet.destination);
+    if (dest != address_map.end()) {
+        Component* source = address_map.find(packet.source)->second;
+        countTraffic(packet.size_bits, 0, packet.size_bits, dest->second->getType() != "Im2col");
 
-        total_bits_transferrd += static_cast<uint64_t>(packet.size_bits);
-        logger.addEdge(packet.source, address_map.find(packet.source)->second->getType(), packet.destination, address_map.find(packet.destination)->second->getType(), packet.size_bits, 1);
-        address_map[packet.destination]->receive(packet);
+        uint32_t bw = std::min(source->getOutPortBW(), dest->second->getInPortBW());
+        auto link = bandwidth_map.find({packet.source, packet.destination});
+        if (link != bandwidth_map.end()) bw = std::min(bw, link->second);
+        uint32_t delay = ceil_div(packet.size_bits, bw) * UNIT_TIME;
+        noteSend({"", packet.source, packet.destination, packet.size_bits, bw, delay});
 
-        uint32_t component_bw = std::min(address_map[packet.source]->getOutPortBW(), address_map[packet.destination]->getInPortBW());
-        if (bandwidth_map.find({packet.source, packet.destination}) != bandwidth_map.end()) {
-            uint32_t bw = std::min(component_bw, bandwidth_map[{packet.source, packet.destination}]);
-            return ceil_div(packet.size_bits, bw) * UNIT_TIME;
-        } else {
-            return ceil_div(packet.size_bits, component_bw) * UNIT_TIME;
-        }
+        logEdge(packet.source, source->getType(), packet.destination, dest->second->getType(), packet.size_bits, 1, delay);
+        if (delivers(packet.destination)) dest->second->receive(packet);
+        return delay;
+    } else if (board) {
+        uint32_t delay = board->sendPackets(Packets(packet.source, packet.destination, packet.size_bits, 1));
+        noteSend({"", packet.source, packet.destination, packet.size_bits, 0, delay});
+        return delay;
     } else {
-        std::cout << "Cannot find the target component!" << std::endl;
-        exit(1);
+        fail("Cannot find the target component!");
     }
 }
 uint32_t Interconnect::sendPackets(const Packets& packets) {
-    if (address_map.find(packets.destination) != address_map.end()) {
-        if (address_map.find(packets.destination)->second->getType() != "Im2col" && min_bandwidth < packets.size_bits) {
-            min_bandwidth = packets.size_bits;
+    return sendPackets(packets, std::numeric_limits<uint32_t>::max());
+}
+uint32_t Interconnect::sendPackets(const Packets& packets, uint32_t max_bw) {
+    if (routed(packets.source, packets.destination)) {
+        uint32_t buffer_addr = route_buffer->getAddress();
+        uint64_t fresh = route_buffer->write(static_cast<uint64_t>(packets.size_bits) * packets.times);
+        uint32_t write = 0;
+        if (fresh) {
+            uint32_t times = static_cast<uint32_t>(std::min<uint64_t>(packets.times, fresh));
+            write = sendPackets(Packets(packets.source, buffer_addr, static_cast<uint32_t>((fresh + times - 1) / times), times, packets.density));
         }
+        Packets read(buffer_addr, packets.destination, packets.size_bits, packets.times, packets.density);
+        return write + sendPackets(read, routedShare(packets.source));
+    }
+    auto dest = address_map.find(packets.destination);
+    if (dest != address_map.end()) {
+        Component* source = address_map.find(packets.source)->second;
+        // Sparse payloads travel compressed, the receiver still sees the logical values
+        uint32_t size_bits = getEncodedSize(packets);
+        countTraffic(size_bits, static_cast<uint64_t>(packets.size_bits) * packets.times,
+                     static_cast<uint64_t>(size_bits) * packets.times, dest->second->getType() != "Im2col");
 
-        total_bits_transferrd += static_cast<uint64_t>(packets.size_bits) * packets.times;
-        logger.addEdge(packets.source, address_map.find(packets.source)->second->getType(), packets.destination, address_map.find(packets.destination)->second->getType(), packets.size_bits, packets.times);
-        address_map[packets.destination]->receive(packets);
+        uint32_t bw = std::min({source->getOutPortBW(), dest->second->getInPortBW(), max_bw});
+        auto link = bandwidth_map.find({packets.source, packets.destination});
+        if (link != bandwidth_map.end()) bw = std::min(bw, link->second);
+        uint32_t delay = ceil_div(size_bits, bw) * packets.times * UNIT_TIME;
+        noteSend({"", packets.source, packets.destination, static_cast<uint64_t>(size_bits) * packets.times, bw, delay});
 
-        uint32_t component_bw = std::min(address_map[packets.source]->getOutPortBW(), address_map[packets.destination]->getInPortBW());
-        if (bandwidth_map.find({packets.source, packets.destination}) != bandwidth_map.end()) {
-            uint32_t bw = std::min(component_bw, bandwidth_map[{packets.source, packets.destination}]);
-            return ceil_div(packets.size_bits, bw) * packets.times * UNIT_TIME;
-        } else {
-            return ceil_div(packets.size_bits, component_bw) * packets.times * UNIT_TIME;
+        logEdge(packets.source, source->getType(), packets.destination, dest->second->getType(), size_bits, packets.times, delay);
+        if (delivers(packets.destination)) dest->second->receive(packets);
+        return delay;
+    } else if (board) {
+        uint32_t delay = board->sendPackets(packets);
+        noteSend({"", packets.source, packets.destination, static_cast<uint64_t>(getEncodedSize(packets)) * packets.times, 0, delay});
+        return delay;
+    } else {
+        fail("Cannot find the target component!");
+    }
+}
+
+uint32_t Interconnect::sendMulticast(const MulticastPackets& packets) {
+    if (!MULTICAST || packets.destinations.size() < 2 || board || route_buffer) {
+        uint32_t delay = 0;
+        for (uint32_t dest: packets.destinations) {
+            delay = std::max(delay, sendPackets(Packets(packets.source, dest, packets.size_bits, packets.times, packets.density)));
+        }
+        return delay;
+    }
+    Component* source = address_map.find(packets.source)->second;
+    uint32_t size_bits = getEncodedSize(Packets(packets.source, packets.source, packets.size_bits, packets.times, packets.density));
+    // The payload crosses the source port once for all of its links to the
+    // destinations, so it gets their shares of the port together
+    uint64_t fanout = 0;
+    for (uint32_t dest: packets.destinations) fanout += bandwidth_map.count({packets.source, dest});
+    uint64_t pooled = static_cast<uint64_t>(source->getOutPortBW()) * std::max<uint64_t>(fanout, 1);
+    uint32_t port_bw = static_cast<uint32_t>(std::min<uint64_t>(pooled, std::numeric_limits<uint32_t>::max()));
+
+    uint32_t delay = 0, unicast_delay = 0;
+    bool sets_min_bandwidth = false;
+    for (uint32_t dest: packets.destinations) {
+        auto target = address_map.find(dest);
+        if (target == address_map.end()) {
+            fail("Cannot find the target component!");
         }
+        uint32_t branch_bw = target->second->getInPortBW();
+        auto link = bandwidth_map.find({packets.source, dest});
+        if (link != bandwidth_map.end()) branch_bw = std::min(branch_bw, link->second);
+        uint32_t bw = std::min(port_bw, branch_bw);
+        uint32_t branch_delay = ceil_div(size_bits, bw) * packets.times * UNIT_TIME;
+        delay = std::max(delay, branch_delay);
+        unicast_delay = std::max(unicast_delay, ceil_div(size_bits, std::min(source->getOutPortBW(), branch_bw)) * packets.times * UNIT_TIME);
+        noteSend({"", packets.source, dest, static_cast<uint64_t>(size_bits) * packets.times, bw, branch_delay});
+        sets_min_bandwidth = sets_min_bandwidth || target->second->getType() != "Im2col";
+
+        logEdge(packets.source, source->getType(), dest, target->second->getType(), size_bits, packets.times, branch_delay);
+        if (delivers(dest)) target->second->receive(Packets(packets.source, dest, packets.size_bits, packets.times, packets.density));
+    }
+    countTraffic(size_bits, static_cast<uint64_t>(packets.size_bits) * packets.times,
+                 static_cast<uint64_t>(size_bits) * packets.times, sets_min_bandwidth);
+
+    uint64_t saved_bits = static_cast<uint64_t>(size_bits) * packets.times * (packets.destinations.size() - 1);
+    if (worker_traffic) {
+        worker_traffic->totals.multicast_bits_saved += saved_bits;
+        worker_traffic->totals.multicast_time_saved += unicast_delay - delay;
     } else {
-        std::cout << "Cannot find the target component!" << std::endl;
-        exit(1);
+        multicast_bits_saved += saved_bits;
+        multicast_time_saved += unicast_delay - delay;
     }
+    return delay;
 }
+
+void Interconnect::countTraffic(uint32_t size_bits, uint64_t raw_bits, uint64_t total_bits, bool sets_min_bandwidth) {
+    if (worker_traffic) {
+        TrafficTotals& totals = worker_traffic->totals;
+        if (sets_min_bandwidth) totals.min_bandwidth = std::max(totals.min_bandwidth, size_bits);
+        totals.raw_bits += raw_bits;
+        totals.total_bits += total_bits;
+        worker_traffic->packet_num++;
+        return;
+    }
+    if (sets_min_bandwidth && min_bandwidth < size_bits) min_bandwidth = size_bits;
+    raw_bits_transferrd += raw_bits;
+    total_bits_transferrd += total_bits;
+    packet_num++;
+}
+
+void Interconnect::noteSend(const CriticalSend& send) {
+    if (worker_traffic) {
+        worker_traffic->slowest.add(send);
+    } else {
+        probe.add(send);
+    }
+}
+
+void Interconnect::startProbe() {
+    if (!board) {
+        probe = CriticalSend();
+        return;
+    }
+    for (uint32_t i = 0; i < board->getChipNum(); i++) board->getChip(i)->probe = CriticalSend();
+}
+
+CriticalSend Interconnect::takeProbe(const std::string& stage) {
+    CriticalSend slowest = probe;
+    if (board) {
+        slowest = CriticalSend();
+        for (uint32_t i = 0; i < board->getChipNum(); i++) slowest.add(board->getChip(i)->probe);
+    }
+    slowest.stage = stage;
+    return slowest;
+}
+
+void Interconnect::parallelSends(size_t count, size_t crossbars, const std::function<void(size_t, size_t)>& body) {
+    uint32_t workers = workersFor(crossbars);
+    if (workers <= 1 || board) {
+        body(0, count);
+        return;
+    }
+    std::vector<WorkerTraffic> traffic(workers);
+    parallelFor(count, workers, [&](size_t begin, size_t end, uint32_t worker) {
+        worker_traffic = &traffic[worker];
+        body(begin, end);
+        worker_traffic = nullptr;
+    });
+    // The workers cover consecutive ranges, so their trace and edges follow the serial order
+    for (auto& t: traffic) {
+        addTotals(t.totals);
+        packet_num += t.packet_num;
+        probe.add(t.slowest);
+        if (isTraced()) std::cout << t.trace.str();
+        for (auto& e: t.edges) logger.addEdge(e.from, e.from_type, e.to, e.to_type, e.size_bits, e.times, e.delay);
+    }
+}
+
+void Interconnect::logEdge(uint32_t from, const std::string& from_type, uint32_t to, const std::string& to_type,
+                           uint32_t size_bits, uint32_t times, uint32_t delay) {
+    if (replaying || !logger.isEnabled()) return;
+    if (worker_traffic) {
+        worker_traffic->edges.push_back({from, from_type, to, to_type, size_bits, times, delay});
+    } else {
+        logger.addEdge(from, from_type, to, to_type, size_bits, times, delay);
+    }
+}
+uint32_t Interconnect::getEncodedSize(const Packets& packets) {
+    if (packets.density < 1.0) {
+        // The metadata of a vector is spread over its bit planes only, not over all of its windows
+        Component* source = getComponent(packets.source);
+        uint32_t planes = std::min(packets.times, source ? source->getPlanes() : getPlanes());
+        return encoding->encode(packets.size_bits, planes, packets.density);
+    }
+    return packets.size_bits;
+}
+Component* Interconnect::getComponent(uint32_t addr) {
+    auto it = address_map.find(addr);
+    return it == address_map.end() ? nullptr : it->second;
+}
+void Interconnect::setBoard(Board* b) { board = b; }
+uint32_t Interconnect::getChipId() { return chip_id; }
 uint32_t Interconnect::getNextAddr() { return next_addr; }
+Arena& Interconnect::getArena() { return layer_arena ? *layer_arena : arena; }
+void Interconnect::useArena(Arena* arena) { layer_arena = arena; }
+
+void Interconnect::release(uint32_t begin_addr, uint32_t end_addr) {
+    auto inside = [&](uint32_t addr) { return addr >= begin_addr && addr < end_addr; };
+    for (uint32_t addr = begin_addr; addr < end_addr; addr += UNIT_ADDR) {
+        address_map.erase(addr);
+        route_fanout.erase(addr);
+    }
+    for (auto it = bandwidth_map.begin(); it != bandwidth_map.end();) {
+        if (inside(it->first.first) || inside(it->first.second)) {
+            it = bandwidth_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 std::string Interconnect::getType() { return "Interconnection"; }
 uint32_t Interconnect::getCrossbarNum() { return crossbar_num; }
-double Interconnect::getCrossbarUsage() { return static_cast<double>(crossbar_valid_area) / (crossbar_num * CROSSBAR_SIZE * CROSSBAR_SIZE); }
+double Interconnect::getCrossbarUsage() { return static_cast<double>(crossbar_valid_area) / (crossbar_num * config.crossbar_size * config.crossbar_size); }
 
 uint32_t Interconnect::getMinBandwidth() { return min_bandwidth; }
-uint64_t Interconnect::getTotalBits() { return total_bits_transferrd; }
+uint64_t Interconnect::getTotalBits() { return allTimesteps(total_bits_transferrd); }
+uint64_t Interconnect::getRawBits() { return allTimesteps(raw_bits_transferrd); }
+uint64_t Interconnect::getPacketNum() { return allTimesteps(packet_num); }
+
+void Interconnect::setEncoding(std::unique_ptr<LinkEncoding> link_encoding) { encoding = std::move(link_encoding); }
+LinkEncoding& Interconnect::getEncoding() { return *encoding; }
+
+uint32_t Interconnect::getPlanes() { return SNN_TIMESTEPS ? 1 : config.bit_precision; }
+
+void Interconnect::addWindowReuse(uint64_t saved_bits, uint64_t buffer_bits) {
+    reuse_bits_saved += saved_bits;
+    line_buffer_bits += buffer_bits;
+}
+uint64_t Interconnect::getReuseBitsSaved() { return allTimesteps(reuse_bits_saved); }
+uint64_t Interconnect::getLineBufferBits() { return line_buffer_bits; }
+uint64_t Interconnect::getMulticastBitsSaved() { return allTimesteps(multicast_bits_saved); }
+uint64_t Interconnect::getMulticastTimeSaved() { return allTimesteps(multicast_time_saved); }
+
+TrafficTotals Interconnect::takeTotals() {
+    TrafficTotals totals;
+    totals.total_bits = total_bits_transferrd;
+    totals.raw_bits = raw_bits_transferrd;
+    totals.reuse_bits_saved = reuse_bits_saved;
+    totals.line_buffer_bits = line_buffer_bits;
+    totals.multicast_bits_saved = multicast_bits_saved;
+    totals.multicast_time_saved = multicast_time_saved;
+    totals.min_bandwidth = min_bandwidth;
+    total_bits_transferrd = raw_bits_transferrd = reuse_bits_saved = line_buffer_bits = 0;
+    multicast_bits_saved = multicast_time_saved = 0;
+    min_bandwidth = 0;
+    return totals;
+}
+
+void Interconnect::addTotals(const TrafficTotals& totals) {
+    total_bits_transferrd += totals.total_bits;
+    raw_bits_transferrd += totals.raw_bits;
+    reuse_bits_saved += totals.reuse_bits_saved;
+    line_buffer_bits += totals.line_buffer_bits;
+    multicast_bits_saved += totals.multicast_bits_saved;
+    multicast_time_saved += totals.multicast_time_saved;
+    min_bandwidth = std::max(min_bandwidth, totals.min_bandwidth);
+}
+
+void Interconnect::setLayerCache(LayerCache* cache) { layer_cache = cache; }
+LayerCache* Interconnect::getLayerCache() { return layer_cache; }
+
+void Interconnect::setTracking(bool enable) {
+    if (board) {
+        fail("Incremental re-simulation needs a single chip!");
+    }
+    tracking = enable;
+}
+
+bool Interconnect::isTracking() { return tracking; }
+void Interconnect::setOwner(int layer) { owner = layer; }
+void Interconnect::setReplay(bool enable) { replaying = enable; }
+
+int Interconnect::getOwner(uint32_t addr) {
+    auto it = owners.find(addr);
+    return it == owners.end() ? -1 : it->second;
+}
+
+bool Interconnect::routed(uint32_t src_addr, uint32_t dest_addr) {
+    return route_buffer && src_addr != route_buffer->getAddress() && route_targets.count(dest_addr);
+}
+
+uint32_t Interconnect::routedShare(uint32_t src_addr) {
+    auto fanout = route_fanout.find(src_addr);
+    if (fanout == route_fanout.end()) return std::numeric_limits<uint32_t>::max();
+    // The link into the buffer stands in for the links to the targets
+    Component* source = address_map.find(src_addr)->second;
+    return source->getOutPortShare(source->getOutPortNum() - 1 + fanout->second);
+}
+
+void Interconnect::routeThrough(Buffer* buffer, const std::vector<std::vector<uint32_t>>& target_groups) {
+    if (buffer && board) {
+        fail("Inter-layer buffers need a single chip!");
+    }
+    route_buffer = buffer;
+    route_targets.clear();
+    if (!buffer) return;
+    for (auto& targets: target_groups) route_targets.insert(targets.begin(), targets.end());
+}
+
+// Outputs of a replayed layer already reached its consumers in the first run
+bool Interconnect::delivers(uint32_t dest_addr) {
+    return !replaying || getOwner(dest_addr) == owner;
+}
+
+void Interconnect::updateBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw) {
+    auto link = bandwidth_map.find({src_addr, dest_addr});
+    if (link == bandwidth_map.end()) {
+        fail("Cannot find the target link!");
+    }
+    if (!bw) {
+        fail("Link bandwidth must be positive!");
+    }
+    link->second = bw;
+    // Every link is driven by the layer of its source, or of its destination when the host sends
+    int sender = getOwner(src_addr);
+    markDirty(sender >= 0 ? sender : getOwner(dest_addr));
+}
+
+void Interconnect::markDirty(int layer) {
+    if (layer >= 0) dirty.insert(layer);
+}
+
+std::set<int> Interconnect::takeDirty() {
+    std::set<int> layers;
+    layers.swap(dirty);
+    return layers;
+}
 
 // CIMCrossbar
 CIMCrossbar::CIMCrossbar(uint32_t size, Interconnect* ic, uint32_t row_num, uint32_t vol_num) 
     : Component(size, ic) {
         valid_volumes = vol_num;
         valid_rows = row_num;
-        in_port_bw = CB_IN_BW;
-        out_port_bw = CB_OUT_BW;
+        in_port_bw = interconnect->getConfig().crossbar_size;
+        out_port_bw = interconnect->getConfig().crossbar_size;
     }
 
 void CIMCrossbar::processData(uint32_t dataSize) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Processing data | Data Size: " << std::dec << dataSize << " bits\n";
 }
 
@@ -190,7 +603,7 @@ void CIMCrossbar::receive(Packet packet) {
     //     std::cout << "Packet over size!" << std::endl;
     //     exit(1);
     // }
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packet.source 
                 << " | Packet Size: " << std::dec << packet.size_bits 
                 << " bits. Processing...\n";
@@ -200,10 +613,9 @@ void CIMCrossbar::receive(Packet packet) {
 
 void CIMCrossbar::receive(Packets packets) {
     if (size_bits < packets.size_bits) {
-        std::cout << "Packets over size!" << std::endl;
-        exit(1);
+        fail("Packets over size!");
     }
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.size_bits 
                 << " bits. Processing...\n";
@@ -224,32 +636,52 @@ uint32_t CIMCrossbar::getValidArea() {
     return valid_rows * valid_volumes;
 }
 
+uint32_t CIMCrossbar::getValidRows() { return valid_rows; }
+
 uint32_t CIMCrossbar::getTimes() {
     return input_times;
 }
 
+void CIMCrossbar::clearInput() { input_times = 0; }
+
+void CIMCrossbar::load(uint32_t times) { input_times = times; }
+
 Host::Host(uint32_t size, Interconnect* ic) 
 : Component(size, ic) {}
+
+// Whole bursts spread over the channels, after one access latency
+uint32_t Host::access(uint64_t bits) {
+    if (!DRAM_BW || !bits) return 0;
+    return DRAM_LATENCY * UNIT_TIME + transfer(bits);
+}
+
+uint32_t Host::transfer(uint64_t bits) {
+    if (!DRAM_BW || !bits) return 0;
+    uint64_t bursts = (bits + DRAM_BURST_BITS - 1) / DRAM_BURST_BITS;
+    uint64_t rounds = (bursts + DRAM_CHANNELS - 1) / DRAM_CHANNELS;
+    uint64_t burst_time = (DRAM_BURST_BITS + DRAM_BW - 1) / std::max<uint64_t>(DRAM_BW, 1);
+    return static_cast<uint32_t>(rounds * burst_time) * UNIT_TIME;
+}
+
 std::string Host::getType() { return "Host"; }
 
 // Accumulator
-Accumulator::Accumulator(uint32_t size, Interconnect* ic)
-    : Component(size, ic) {
-        in_port_bw = ACC_IN_BW;
-        out_port_bw = ACC_OUT_BW;
+Accumulator::Accumulator(uint32_t size, Interconnect* ic, uint32_t precision)
+    : Component(size, ic), precision(precision) {
+        in_port_bw = interconnect->getConfig().crossbar_size;
+        out_port_bw = interconnect->getConfig().crossbar_size;
     }
 
 void Accumulator::processData(uint32_t data_size, uint32_t data_times) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Accumulating data | Data Size: " << std::dec << data_times << "x " << std::dec << data_size << " bits\n";
 }
 
 void Accumulator::receive(Packets packets) {
     if (size_bits < packets.size_bits) {
-        std::cout << "Packets over size!" << std::endl;
-        exit(1);
+        fail("Packets over size!");
     }
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
                 << " bits. Processing...\n";
@@ -259,7 +691,7 @@ void Accumulator::receive(Packets packets) {
 }
 
 uint32_t Accumulator::send(uint32_t dest) {
-    Packets packets(address, dest, compute_bits/BIT_PRECISION, input_times);
+    Packets packets(address, dest, compute_bits/precision, input_times);
     uint32_t delay = interconnect->sendPackets(packets);
     input_times = 0;
     compute_bits = 0;
@@ -273,21 +705,20 @@ uint32_t Accumulator::getTimes() { return input_times; }
 // Activation
 Activation::Activation(uint32_t size, Interconnect* ic, std::string activation_type)
     : Component(size, ic), activation_type(activation_type) {
-        in_port_bw = ACT_IN_BW;
-        out_port_bw = ACT_OUT_BW;
+        in_port_bw = interconnect->getConfig().crossbar_size;
+        out_port_bw = interconnect->getConfig().crossbar_size;
     }
 
 void Activation::processData(uint32_t dataSize) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Activating | Data Size: " << std::dec << dataSize << " bits\n";
 }
 
 void Activation::receive(Packets packets) {
     if (size_bits < packets.size_bits) {
-        std::cout << "Packet over size!" << std::endl;
-        exit(1);
+        fail("Packet over size!");
     }
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
                 << " bits. Processing...\n";
@@ -297,18 +728,32 @@ void Activation::receive(Packets packets) {
 }
 
 uint32_t Activation::send(uint32_t dest) {
-    Packets packets(address, dest, compute_bits, input_times);
+    Packets packets(address, dest, compute_bits, getOutputTimes(), output_density);
     return interconnect->sendPackets(packets);
 }
 std::string Activation::getType() { return "Activation"; }
 
 uint32_t Activation::getTimes() { return input_times; }
 
+uint32_t Activation::getOutputTimes() {
+    uint32_t in = input_planes ? input_planes : interconnect->getPlanes();
+    if (in == getPlanes()) return input_times;
+    return static_cast<uint32_t>(static_cast<uint64_t>(input_times) * getPlanes() / in);
+}
+
+void Activation::setInputPlanes(uint32_t bit_planes) { input_planes = bit_planes; }
+uint32_t Activation::getBits() { return compute_bits; }
+
+void Activation::load(uint32_t bits, uint32_t times) {
+    compute_bits = bits;
+    input_times = times;
+}
+
 // Im2col
 Im2col::Im2col(uint32_t size, Interconnect* ic, uint32_t kernel_size[3], uint32_t input_size[3], uint32_t stride, uint32_t pad) // size is crossbar size
 : Component(size, ic), stride(stride), pad(pad) {
-    in_port_bw = IM_IN_BW;
-    out_port_bw = IM_OUT_BW;
+    in_port_bw = interconnect->getConfig().bandwidth;
+    out_port_bw = interconnect->getConfig().bandwidth;
     std::copy(input_size, input_size + 3, this->input_size);
     std::copy(kernel_size, kernel_size + 3, this->kernel_size);
     uint32_t output_bits = kernel_size[0] * kernel_size[1] * input_size[2];
@@ -323,31 +768,88 @@ Im2col::Im2col(uint32_t size, Interconnect* ic, uint32_t kernel_size[3], uint32_
     }
 }
 
+void Im2col::setLineBuffer(bool enable) { line_buffer = enable; }
+
+// Input pixels touched by all windows; each is sent once when a line buffer keeps the overlap
+uint32_t Im2col::getUniqueNums(uint32_t steps) {
+    uint32_t out_rows = std::max<uint32_t>((input_size[0] - kernel_size[0] + 1 + pad * 2) / stride, 1);
+    uint32_t out_cols = std::max<uint32_t>(steps / out_rows, 1);
+    uint32_t used_rows = kernel_size[0] + (out_rows - 1) * std::min(stride, kernel_size[0]);
+    uint32_t used_cols = kernel_size[1] + (out_cols - 1) * std::min(stride, kernel_size[1]);
+    return used_rows * used_cols * input_size[2];
+}
+
+uint32_t Im2col::getLineBufferBits() {
+    uint32_t padded_width = input_size[1] + pad * 2;
+    return ((kernel_size[0] - 1) * padded_width + kernel_size[1]) * input_size[2] * getPlanes();
+}
+
+uint32_t Im2col::getWindows() {
+    return (input_size[0] - kernel_size[0] + 1 + pad * 2) / stride * (input_size[1] - kernel_size[1] + 1 + pad * 2) / stride;
+}
+
+// The rows and columns getUniqueNums() counts, split over the windows that bring them in
+std::vector<uint32_t> Im2col::getWindowPixels() {
+    if (!line_buffer) return {};
+    uint32_t steps = getWindows();
+    uint32_t out_rows = std::max<uint32_t>((input_size[0] - kernel_size[0] + 1 + pad * 2) / stride, 1);
+    uint32_t out_cols = std::max<uint32_t>(steps / out_rows, 1);
+    std::vector<uint32_t> pixels(steps);
+    for (uint32_t w = 0; w < steps; w++) {
+        uint32_t rows = std::min(w / out_cols, out_rows - 1) ? std::min(stride, kernel_size[0]) : kernel_size[0];
+        uint32_t cols = w % out_cols ? std::min(stride, kernel_size[1]) : kernel_size[1];
+        pixels[w] = rows * cols * input_size[2];
+    }
+    return pixels;
+}
+
 uint32_t Im2col::send(std::vector<uint32_t> addresses) {
     if (addresses.size() % packets_sizes.size() != 0) {
-        std::cout << "Addresses error!" << std::endl;
-        exit(1);
+        fail("Addresses error!");
     }
-    uint32_t packet_num = (input_size[0] - kernel_size[0] + 1 + pad * 2) / stride * (input_size[1] - kernel_size[1] + 1 + pad * 2) / stride * BIT_PRECISION;
+    uint32_t steps = getWindows();
+    uint32_t packet_num = steps * getPlanes();
+    uint64_t window_nums = static_cast<uint64_t>(kernel_size[0]) * kernel_size[1] * input_size[2];
+    uint64_t unique_nums = getUniqueNums(steps);
+    uint64_t saved_bits = 0;
+
     uint32_t count = 0;
     uint32_t delay = 0;
+    std::vector<MulticastPackets> slices;   // the crossbars of one slice share a message with MULTICAST
     for(auto &addr: addresses) {
-        Packets packets(address, addr, packets_sizes[count], packet_num);
-        delay = interconnect->sendPackets(packets);
+        uint32_t size = packets_sizes[count];
+        if (line_buffer && steps > 0) {
+            // Each crossbar slice only receives its share of the new pixels per window step
+            uint64_t new_nums = (static_cast<uint64_t>(size) * unique_nums + window_nums * steps - 1) / (window_nums * steps);
+            uint32_t reduced = static_cast<uint32_t>(std::max<uint64_t>(std::min<uint64_t>(new_nums, size), 1));
+            saved_bits += static_cast<uint64_t>(size - reduced) * packet_num;
+            size = reduced;
+        }
+        if (MULTICAST) {
+            if (slices.size() <= count) slices.emplace_back(address, size, packet_num);
+            slices[count].destinations.push_back(addr);
+        } else {
+            Packets packets(address, addr, size, packet_num);
+            delay = std::max(delay, interconnect->sendPackets(packets));
+        }
         count = (count+1) % packets_sizes.size();
     }
+    for (auto& slice: slices) delay = std::max(delay, interconnect->sendMulticast(slice));
+    if (line_buffer) {
+        interconnect->addWindowReuse(saved_bits, getLineBufferBits());
+    }
     return delay;
 }
 std::string Im2col::getType() { return "Im2col"; }
 
 // Flatten
 Flatten::Flatten(uint32_t size, Interconnect* ic): Component(size, ic) {
-    in_port_bw = FLATTEN_IN_BW;
-    out_port_bw = FLATTEN_OUT_BW;
+    in_port_bw = interconnect->getConfig().bandwidth;
+    out_port_bw = interconnect->getConfig().bandwidth;
 }
 
 void Flatten::receive(Packets packets) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
                 << " bits. Processing...\n";
@@ -356,14 +858,15 @@ void Flatten::receive(Packets packets) {
 
 uint32_t Flatten::send(std::vector<uint32_t> addresses) {
     uint32_t delay = 0;
+    uint32_t left_bits = total_bits;
     for(auto &addr: addresses) {
-        if (size_bits * BIT_PRECISION < total_bits) {
-            Packets packets(address, addr, size_bits, BIT_PRECISION);
-            delay = interconnect->sendPackets(packets);
-            total_bits -= size_bits * BIT_PRECISION;
+        if (size_bits * getPlanes() < left_bits) {
+            Packets packets(address, addr, size_bits, getPlanes(), output_density);
+            delay = std::max(delay, interconnect->sendPackets(packets));
+            left_bits -= size_bits * getPlanes();
         } else {
-            Packets packets(address, addr, total_bits / BIT_PRECISION, BIT_PRECISION);
-            delay = interconnect->sendPackets(packets);
+            Packets packets(address, addr, left_bits / getPlanes(), getPlanes(), output_density);
+            delay = std::max(delay, interconnect->sendPackets(packets));
         }
     }
     return delay;
@@ -374,25 +877,25 @@ std::string Flatten::getType() { return "Flatten"; }
 // Pool
 Pool::Pool(uint32_t size, Interconnect* ic, std::string pooling_type)
     : Component(size, ic), type(pooling_type) {
-        in_port_bw = POOL_IN_BW;
-        out_port_bw = POOL_OUT_BW;  
+        in_port_bw = interconnect->getConfig().bandwidth;
+        out_port_bw = interconnect->getConfig().bandwidth;  
     }
 
 void Pool::processData(uint32_t dataSize) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Pooling | Data Size: " << std::dec << dataSize << " bits\n";
     input_bits += dataSize;
 }
 
 void Pool::receive(Packet packet) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packet.source 
                 << " | Packet Size: " << std::dec << packet.size_bits 
                 << " bits. Processing...\n";
     processData(packet.size_bits); // Simulate processing the data
 }
 void Pool::receive(Packets packets) {
-    std::cout << "[0x" << std::hex << address 
+    trace() << "[0x" << std::hex << address 
                 << "] Received data packet from 0x" << packets.source 
                 << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
                 << " bits. Processing...\n";
@@ -400,19 +903,18 @@ void Pool::receive(Packets packets) {
 }
 
 void Pool::pooling(uint32_t input_size[2], uint32_t kernel_size[1]) {
-    in_port_bw = POOL_IN_BW;
-    out_port_bw = POOL_OUT_BW;  
-    uint32_t input_nums = input_bits / BIT_PRECISION;
+    in_port_bw = interconnect->getConfig().bandwidth;
+    out_port_bw = interconnect->getConfig().bandwidth;  
+    uint32_t input_nums = input_bits / getPlanes();
     if (input_nums < input_size[0] * input_size[1] * input_size[2]) {
-        std::cout << "Input size error!" << std::endl;
-        exit(1);
+        fail("Input size error!");
     }
     uint32_t old_size = input_size[0] * input_size[1];
     uint32_t new_size = (input_size[0] / kernel_size[0]) * (input_size[1] / kernel_size[1]);
     uint32_t output_nums = input_nums / old_size * new_size;
     // uint32_t output_bits = input_size[2] * new_size;
     input_nums = output_nums;
-    input_bits = input_nums * BIT_PRECISION;
+    input_bits = input_nums * getPlanes();
     while(1) {
         if (output_nums > size_bits) {
             packets_sizes.emplace_back(size_bits);
@@ -424,25 +926,151 @@ void Pool::pooling(uint32_t input_size[2], uint32_t kernel_size[1]) {
     } 
 }
 
+void Pool::restoreInput(const Pool& saved) {
+    input_bits = saved.input_bits;
+    packets_sizes = saved.packets_sizes;
+}
+
 uint32_t Pool::send(std::vector<uint32_t> addresses) {
     if (addresses.size() % packets_sizes.size() != 0) {
-        std::cout << "Addresses error!" << std::endl;
-        exit(1);
+        fail("Addresses error!");
     }
     uint32_t count = 0;
     uint32_t delay = 0;
+    std::vector<MulticastPackets> slices;
     for(auto &addr: addresses) {
-        Packets packets(address, addr, packets_sizes[count], BIT_PRECISION);
-        delay = interconnect->sendPackets(packets);
+        if (MULTICAST) {
+            if (slices.size() <= count) slices.emplace_back(address, packets_sizes[count], getPlanes(), output_density);
+            slices[count].destinations.push_back(addr);
+        } else {
+            Packets packets(address, addr, packets_sizes[count], getPlanes(), output_density);
+            delay = std::max(delay, interconnect->sendPackets(packets));
+        }
         count = (count + 1) % packets_sizes.size();
     }
+    for (auto& slice: slices) delay = std::max(delay, interconnect->sendMulticast(slice));
     return delay;
 }
 
 uint32_t Pool::send(uint32_t dest) {
-    Packets packets(address, dest, input_bits/BIT_PRECISION, BIT_PRECISION);
+    Packets packets(address, dest, input_bits/getPlanes(), getPlanes(), output_density);
     return interconnect->sendPackets(packets);
 }
 
 std::string Pool::getType() { return type + " Pooling"; }
 
+
+
+// Buffer
+Buffer::Buffer(uint32_t capacity_bits, uint32_t banks, Interconnect* ic)
+    : Component(capacity_bits, ic), banks(banks) {
+        in_port_bw = banks * BUFFER_WRITE_BW;
+        out_port_bw = banks * BUFFER_READ_BW;
+    }
+
+void Buffer::receive(Packet packet) {
+    receive(Packets(packet.source, address, packet.size_bits, 1));
+}
+
+void Buffer::receive(Packets packets) {
+    trace() << "[0x" << std::hex << address 
+                << "] Buffering data from 0x" << packets.source 
+                << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
+                << " bits\n";
+}
+
+void Buffer::expect(uint64_t bits) {
+    tensor_bits = bits;
+    stored_bits = 0;
+}
+
+uint64_t Buffer::write(uint64_t bits) {
+    uint64_t fresh = std::min(bits, tensor_bits - stored_bits);
+    stored_bits += fresh;
+    return fresh;
+}
+
+uint64_t Buffer::getStoredBits() { return stored_bits; }
+uint32_t Buffer::getBanks() { return banks; }
+
+uint32_t Buffer::getStall() {
+    if (stored_bits <= size_bits) return 0;
+    return static_cast<uint32_t>((stored_bits - size_bits + out_port_bw - 1) / out_port_bw) * UNIT_TIME;
+}
+
+std::string Buffer::getType() { return "Buffer"; }
+
+// Merge
+Merge::Merge(uint32_t size, Interconnect* ic, std::string merge_type, uint32_t input_num)
+    : Component(size, ic), type(merge_type), input_num(input_num) {
+        in_port_bw = interconnect->getConfig().bandwidth;
+        out_port_bw = interconnect->getConfig().bandwidth;
+    }
+
+void Merge::receive(Packets packets) {
+    trace() << "[0x" << std::hex << address 
+                << "] Received data packet from 0x" << packets.source 
+                << " | Packet Size: " << std::dec << packets.times << "x " << std::dec << packets.size_bits 
+                << " bits. Merging...\n";
+    input_bits += packets.size_bits * packets.times;
+}
+
+uint32_t Merge::getOutputNums() {
+    uint32_t input_nums = input_bits / getPlanes();
+    if (type == "Add") {
+        return input_nums / input_num;
+    }
+    return input_nums;
+}
+
+uint32_t Merge::send(std::vector<uint32_t> addresses) {
+    std::vector<uint32_t> packets_sizes;
+    uint32_t output_nums = getOutputNums();
+    while(1) {
+        if (output_nums > size_bits) {
+            packets_sizes.emplace_back(size_bits);
+            output_nums -= size_bits;
+        } else {
+            packets_sizes.emplace_back(output_nums);
+            break;
+        }
+    }
+    uint32_t count = 0;
+    uint32_t delay = 0;
+    std::vector<MulticastPackets> slices;
+    for(auto &addr: addresses) {
+        if (MULTICAST) {
+            if (slices.size() <= count) slices.emplace_back(address, packets_sizes[count], getPlanes(), output_density);
+            slices[count].destinations.push_back(addr);
+        } else {
+            Packets packets(address, addr, packets_sizes[count], getPlanes(), output_density);
+            delay = std::max(delay, interconnect->sendPackets(packets));
+        }
+        count = (count + 1) % packets_sizes.size();
+    }
+    for (auto& slice: slices) delay = std::max(delay, interconnect->sendMulticast(slice));
+    return delay;
+}
+
+uint32_t Merge::send(uint32_t dest) {
+    Packets packets(address, dest, getOutputNums(), getPlanes(), output_density);
+    return interconnect->sendPackets(packets);
+}
+
+std::string Merge::getType() { return type; }
+
+OperandBuffer::OperandBuffer(uint32_t size, Interconnect* ic)
+    : Component(size, ic) {
+        in_port_bw = interconnect->getConfig().bandwidth;
+        out_port_bw = interconnect->getConfig().bandwidth;
+    }
+
+std::string OperandBuffer::getType() { return "Operand Buffer"; }
+
+Softmax::Softmax(uint32_t size, Interconnect* ic)
+    : Component(size, ic) {
+        in_port_bw = interconnect->getConfig().crossbar_size;
+        out_port_bw = interconnect->getConfig().crossbar_size;
+    }
+
+std::string Softmax::getType() { return "Softmax"; }
@@ -1,16 +1,27 @@
 #pragma once
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <tuple>
 #include <algorithm>
 #include <utility>
 #include <functional>
 #include <cstdint>
 #include <limits>
+#include <set>
 #include "dgraph_logger.hpp"
+#include "arena.hpp"
+#include "encoding.hpp"
 #include "configuration.hpp"
 
 uint32_t ceil_div(uint32_t a, uint32_t b);
+// A traffic count of the simulated SNN timestep over all SNN_TIMESTEPS of the run
+uint64_t allTimesteps(uint64_t count);
+
+// Stream of the per-packet trace, setTrace(false) silences it for batch runs
+std::ostream& trace();
+void setTrace(bool enable);
+bool isTraced();
 
 struct Packet {
     uint32_t source;
@@ -25,8 +36,20 @@ struct Packets {
     uint32_t destination;
     uint32_t size_bits;
     uint32_t times;
+    double density;     // fraction of nonzero values, below 1 the link encoding compresses them
+
+    Packets(uint32_t src, uint32_t dest, uint32_t size, uint32_t times, double density = 1.0);
+};
+
+// The same packets for every destination, see MULTICAST
+struct MulticastPackets {
+    uint32_t source;
+    std::vector<uint32_t> destinations;
+    uint32_t size_bits;
+    uint32_t times;
+    double density;
 
-    Packets(uint32_t src, uint32_t dest, uint32_t size, uint32_t times);
+    MulticastPackets(uint32_t src, uint32_t size, uint32_t times, double density = 1.0);
 };
 
 struct pair_hash {
@@ -36,6 +59,34 @@ struct pair_hash {
 };
 
 class Interconnect;
+class Board;
+class LayerCache;
+class Buffer;
+
+// Interconnect counters, used to replay the transfers of a cached layer
+struct TrafficTotals {
+    uint64_t total_bits = 0;
+    uint64_t raw_bits = 0;
+    uint64_t reuse_bits_saved = 0;
+    uint64_t line_buffer_bits = 0;
+    uint64_t multicast_bits_saved = 0;
+    uint64_t multicast_time_saved = 0;
+    uint32_t min_bandwidth = 0;
+};
+
+// Slowest of a set of concurrent sends, the one their stage waits for
+struct CriticalSend {
+    std::string stage;
+    uint32_t source = 0;
+    uint32_t destination = 0;
+    uint64_t bits = 0;          // as encoded on the link, all times
+    uint32_t bandwidth = 0;     // 0 on an inter-chip link
+    uint32_t time = 0;
+    uint32_t runner_up = 0;     // slowest send on any other link, if has_runner_up
+    bool has_runner_up = false;
+
+    void add(const CriticalSend& other);
+};
 
 // Generic Component class
 class Component {
@@ -46,6 +97,8 @@ protected:
     uint32_t out_port_bw = std::numeric_limits<uint32_t>::max();   // the default bandwidth is unlimited
     uint32_t in_port_num = 0;
     uint32_t out_port_num = 0;
+    double output_density = 1.0;
+    uint32_t planes = 0;        // bit planes of the values it passes on, 0 for those of the interconnect
     Interconnect* interconnect;
     std::string type;
 
@@ -53,6 +106,7 @@ public:
     Component(uint32_t size, Interconnect* ic);
 
     void setAddr(uint32_t addr);
+    void setInterconnect(Interconnect* ic);
         
     // Can be overided if needed
     virtual void receive(Packet packet);
@@ -61,6 +115,7 @@ public:
     virtual uint32_t send(uint32_t dest);
     virtual uint32_t send(uint32_t dest, uint32_t size);
     virtual uint32_t send(uint32_t dest, uint32_t size, uint32_t times);
+    uint32_t multicast(const std::vector<uint32_t>& dests, uint32_t size, uint32_t times);
 
     uint32_t getAddress();
     uint32_t getSize();
@@ -68,8 +123,14 @@ public:
     uint32_t getOutPortBW();
     uint32_t getInPortNum();
     uint32_t getOutPortNum();
+    // Bandwidth of each of ports links sharing the out port
+    uint32_t getOutPortShare(uint32_t ports);
     uint32_t addInPorts(uint32_t port_num); 
     uint32_t addOutPorts(uint32_t port_num); 
+    void setSparsity(double zero_fraction);
+    // Activation precision of a layer with its own, see Model::Conv()
+    void setPlanes(uint32_t bit_planes);
+    uint32_t getPlanes();
     virtual std::string getType();
     virtual ~Component() {}
 };
@@ -81,26 +142,152 @@ private:
     std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t, pair_hash>bandwidth_map;
     uint32_t next_addr = UNIT_ADDR;
     DotGraphLogger logger;
+    Arena arena;        // owns the layers and components of this simulation
+    Arena* layer_arena = nullptr;   // replaces it while a streamed layer is built
     uint32_t crossbar_num = 0;
     uint32_t crossbar_valid_area = 0;
     uint32_t min_bandwidth = 0;
     uint64_t total_bits_transferrd = 0;
+    uint64_t raw_bits_transferrd = 0;
+    uint64_t packet_num = 0;
+    std::unique_ptr<LinkEncoding> encoding;
+    uint64_t reuse_bits_saved = 0;
+    uint64_t line_buffer_bits = 0;
+    uint64_t multicast_bits_saved = 0;
+    uint64_t multicast_time_saved = 0;
+    SimConfig config;
+    uint32_t class_links[LINK_CLASS_NUM] = {};
+    uint32_t chip_id = 0;
+    Board* board = nullptr;     // set when this interconnect is one chip of a board
+    LayerCache* layer_cache = nullptr;
+
+    // Dependency tracking for incremental re-simulation, see Model::update()
+    bool tracking = false;
+    bool replaying = false;
+    int owner = -1;                                         // layer the new components and sends belong to, -1 for none
+    std::unordered_map<uint32_t, int> owners;               // layer of every component registered while tracking
+    std::set<int> dirty;
+
+    // Buffer the sends to route_targets pass through, see routeThrough()
+    Buffer* route_buffer = nullptr;
+    std::unordered_set<uint32_t> route_targets;
+    // Links every routed source would drive without its buffer
+    std::unordered_map<uint32_t, uint32_t> route_fanout;
+
+    int getOwner(uint32_t addr);
+    bool delivers(uint32_t dest_addr);
+    bool routed(uint32_t src_addr, uint32_t dest_addr);
+    // Bandwidth the source would give each of its targets without the buffer
+    uint32_t routedShare(uint32_t src_addr);
+    // max_bw caps the bandwidth of the link, for reads out of a route buffer
+    uint32_t sendPackets(const Packets& packets, uint32_t max_bw);
+    // Adds one message to the counters, or to those of the calling worker inside parallelSends()
+    void countTraffic(uint32_t size_bits, uint64_t raw_bits, uint64_t total_bits, bool sets_min_bandwidth);
+    // Adds an edge to the network graph, after the other workers' inside parallelSends()
+    void logEdge(uint32_t from, const std::string& from_type, uint32_t to, const std::string& to_type,
+                 uint32_t size_bits, uint32_t times, uint32_t delay);
+
+    CriticalSend probe;
+    void noteSend(const CriticalSend& send);
 
 public:
-    Interconnect(const std::string& dotFileName);
+    Interconnect(const std::string& dotFileName, uint32_t chip_id = 0);
 
     uint32_t registerComponent(Component* component);
+    // Registers on this chip, bypassing the board placement
+    // layer is the owner on the interconnect the model registers with
+    uint32_t registerLocal(Component* component, int layer);
+    Component* getComponent(uint32_t addr);
+    void setBoard(Board* board);
+    uint32_t getChipId();
     void setBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw);
+    // Link whose bandwidth is the current bandwidth of its class
+    void setBandWidth(uint32_t src_addr, uint32_t dest_addr, LinkClass link_class);
+    uint32_t getClassLinks(LinkClass link_class);
+
+    // Set before any component is created
+    void setConfig(const SimConfig& sim_config);
+    const SimConfig& getConfig();
     uint32_t getBandWidth(uint32_t src_addr, uint32_t dest_addr);
+    // Every link of this chip as source, destination and bandwidth, in address order
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> getLinks();
 
     uint32_t sendPacket(const Packet& packet);
     uint32_t sendPackets(const Packets& packets);
+    // One message for all destinations, the slowest branch sets its delay.
+    // Unicasts to each of them without MULTICAST, on a board or through a buffer
+    uint32_t sendMulticast(const MulticastPackets& packets);
+    // Bits a transfer occupies on the link after encoding
+    uint32_t getEncodedSize(const Packets& packets);
     uint32_t getNextAddr();
+    Arena& getArena();
+    // New layers and components go to the given arena until the next call, nullptr for the own one
+    void useArena(Arena* arena);
+    // Forgets the components in [begin_addr, end_addr) and every link to or from them,
+    // their memory is freed with the arena they came from. Single chip only.
+    void release(uint32_t begin_addr, uint32_t end_addr);
     std::string getType();
     uint32_t getCrossbarNum();
     double getCrossbarUsage();
     uint32_t getMinBandwidth();
+    // Traffic counters cover the whole run, all SNN_TIMESTEPS timesteps in SNN mode
     uint64_t getTotalBits();
+    uint64_t getRawBits();
+    // Packet and Packets messages simulated on this chip, a batch counts once
+    uint64_t getPacketNum();
+
+    // Until the next call, links and sends to the target addresses go through
+    // the buffer: the sending layer writes its output once and every target
+    // reads it, no faster than the layer could have sent to it directly.
+    // Multicast stays off for these sends. nullptr connects them directly
+    // again. Single chip only.
+    void routeThrough(Buffer* buffer, const std::vector<std::vector<uint32_t>>& target_groups);
+
+    // Slowest send since startProbe(), on every chip of a board
+    void startProbe();
+    CriticalSend takeProbe(const std::string& stage);
+
+    // Calls body(begin, end) on ranges covering [0, count) whose sends touch
+    // disjoint components, on several workers when the layer has enough
+    // crossbars. Stays serial on a board. The trace and the network graph of
+    // the workers are written afterwards, in the order of a serial run.
+    void parallelSends(size_t count, size_t crossbars, const std::function<void(size_t, size_t)>& body);
+
+    void setEncoding(std::unique_ptr<LinkEncoding> link_encoding);
+    LinkEncoding& getEncoding();
+    // Transfers per activation value: its bit planes, or one spike per timestep in SNN mode
+    uint32_t getPlanes();
+
+    void addWindowReuse(uint64_t saved_bits, uint64_t buffer_bits);
+    uint64_t getReuseBitsSaved();
+    uint64_t getLineBufferBits();
+    // Link bits and summed message time multicast saved over one unicast per destination
+    uint64_t getMulticastBitsSaved();
+    uint64_t getMulticastTimeSaved();
+
+    // Returns the counters and restarts them from zero, addTotals puts them
+    // back; the minimum bandwidth takes the larger value
+    TrafficTotals takeTotals();
+    void addTotals(const TrafficTotals& totals);
+
+    // Optional cache of layer results, nullptr disables it
+    void setLayerCache(LayerCache* cache);
+    LayerCache* getLayerCache();
+
+    // Remembers which layer registered every component, so edits after a run
+    // re-simulate only the layers they touch. Set before the model is built,
+    // single chip only.
+    void setTracking(bool enable);
+    bool isTracking();
+    void setOwner(int layer);
+    // A replayed layer adds no links or graph edges and only its own components receive
+    void setReplay(bool enable);
+
+    // Changes the bandwidth of an existing link and marks the layer that sends over it
+    void updateBandWidth(uint32_t src_addr, uint32_t dest_addr, uint32_t bw);
+    void markDirty(int layer);
+    // Layers to re-simulate since the last call
+    std::set<int> takeDirty();
 };
 
 class CIMCrossbar: public Component {
@@ -124,12 +311,25 @@ class CIMCrossbar: public Component {
 
     uint32_t getValidArea();
 
+    uint32_t getValidRows();
+
     uint32_t getTimes();
+
+    // Drops the received input without computing, its result came from the layer cache
+    void clearInput();
+
+    // Input restored to simulate the layer again
+    void load(uint32_t times);
 };
 
+// Host with its DRAM memory controller
 class Host: public Component {
     public:
     Host(uint32_t size, Interconnect* ic);
+    // Unit time the DRAM takes to read or write the given bits, 0 without DRAM_BW
+    uint32_t access(uint64_t bits);
+    // The part of access() the channels are busy, later accesses overlap the latency
+    uint32_t transfer(uint64_t bits);
     std::string getType();
 };
 
@@ -137,9 +337,10 @@ class Accumulator: public Component {
     private:
     uint32_t input_times = 0;
     uint32_t compute_bits = 0;
+    uint32_t precision;     // crossbar columns per weight, reduced to one value
 
     public:
-    Accumulator(uint32_t size, Interconnect* ic);
+    Accumulator(uint32_t size, Interconnect* ic, uint32_t precision);
 
     void processData(uint32_t data_size, uint32_t data_times);
 
@@ -156,6 +357,7 @@ class Activation: public Component {
     std::string activation_type;
     uint32_t input_times = 0;
     uint32_t compute_bits = 0;
+    uint32_t input_planes = 0;  // of the crossbar inputs, 0 for those of the interconnect
     
     public:
     Activation(uint32_t size, Interconnect* ic, std::string activation_type);
@@ -163,10 +365,17 @@ class Activation: public Component {
     void processData(uint32_t dataSize);
 
     void receive(Packets packets) override;
+    using Component::send;
     uint32_t send(uint32_t dest) override;
     std::string getType();
     uint32_t getTimes();
+    // Packets per output, requantized from the input planes to getPlanes()
+    uint32_t getOutputTimes();
+    void setInputPlanes(uint32_t bit_planes);
+    uint32_t getBits();
 
+    // Input replayed from the layer cache
+    void load(uint32_t bits, uint32_t times);
 };
 
 class Im2col: public Component {
@@ -176,10 +385,26 @@ class Im2col: public Component {
     uint32_t stride;
     uint32_t pad;
     std::vector<uint32_t> packets_sizes;
+    bool line_buffer = false;
+
+    uint32_t getUniqueNums(uint32_t steps);
 
     public:
     Im2col(uint32_t size, Interconnect* ic, uint32_t kernel_size[3], uint32_t input_size[3], uint32_t stride, uint32_t pad); // size is crossbar size
 
+    // Keep the kh-1 previous input rows resident and only send the new pixels of each window
+    void setLineBuffer(bool enable);
+
+    // Bits the line buffer has to hold: kh-1 padded rows plus one window row
+    uint32_t getLineBufferBits();
+
+    // Window steps over one input, each one packet per bit plane to every crossbar
+    uint32_t getWindows();
+
+    // New pixels of every window in raster order, the first ones of a row bring
+    // in more. Empty without the line buffer, where all windows are alike.
+    std::vector<uint32_t> getWindowPixels();
+
     uint32_t send(std::vector<uint32_t> addresses);
     std::string getType();
 };
@@ -213,6 +438,9 @@ class Pool: public Component {
 
     void pooling(uint32_t input_size[2], uint32_t kernel_size[1]);
 
+    // Back to the input the saved copy had received, edits such as the sparsity stay
+    void restoreInput(const Pool& saved);
+
     uint32_t send(std::vector<uint32_t> addresses);
 
     uint32_t send(uint32_t dest);
@@ -220,3 +448,69 @@ class Pool: public Component {
     std::string getType();
 };
 
+// On-chip SRAM between a layer and its consumers. The layer writes its output
+// tensor once and every consumer reads it; the banks work in parallel, so
+// they multiply the port bandwidth.
+class Buffer: public Component {
+    private:
+    uint32_t banks;
+    uint64_t tensor_bits = 0;
+    uint64_t stored_bits = 0;
+
+    public:
+    Buffer(uint32_t capacity_bits, uint32_t banks, Interconnect* ic);
+
+    void receive(Packet packet) override;
+    void receive(Packets packets) override;
+
+    // Empties the buffer for an output tensor of the given size
+    void expect(uint64_t bits);
+    // Bits of a send still missing from the tensor, later sends repeat stored data
+    uint64_t write(uint64_t bits);
+    uint64_t getStoredBits();
+    uint32_t getBanks();
+    // Unit time the producer waits because the bits beyond the capacity only
+    // fit once the consumers have read as much out
+    uint32_t getStall();
+
+    std::string getType();
+};
+
+// Joins several input tensors: "Add" sums them element-wise, "Concat" stacks them
+class Merge: public Component {
+    private:
+    std::string type;
+    uint32_t input_num;
+    uint32_t input_bits = 0;
+
+    public:
+    Merge(uint32_t size, Interconnect* ic, std::string merge_type, uint32_t input_num);
+
+    void receive(Packets packets) override;
+
+    uint32_t getOutputNums();
+
+    uint32_t send(std::vector<uint32_t> addresses);
+
+    uint32_t send(uint32_t dest);
+
+    std::string getType();
+};
+
+// Holds both activation operands of a MatMulLayer: it writes the second into
+// the crossbars and streams the first through them
+class OperandBuffer: public Component {
+    public:
+    OperandBuffer(uint32_t size, Interconnect* ic);
+
+    std::string getType();
+};
+
+// Softmax over rows spread across several activation units: each sends its
+// partial maximum and sum per row, the unit returns the normalizer
+class Softmax: public Component {
+    public:
+    Softmax(uint32_t size, Interconnect* ic);
+
+    std::string getType();
+};
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <limits>
 
 #ifndef CROSSBAR_SIZE
 #define CROSSBAR_SIZE 32
@@ -11,37 +11,165 @@
 #define BIT_PRECISION 1
 #endif
 
-constexpr uint32_t ACC_SIZE = CROSSBAR_SIZE;
-constexpr uint32_t ACT_SIZE = CROSSBAR_SIZE;  
+/* Convolution mapping: 0-k2col, 1-im2col, 2-im2col with line buffer */
+#ifndef CONV_MAPPING
+#define CONV_MAPPING 0
+#endif
+
+/* Sparse link encoding: 0-dense, 1-bitmap, 2-run-length, 3-CSR, 4-address events.
+   SNN mode uses address events unless another one is set */
+#ifndef LINK_ENCODING
+#define LINK_ENCODING 0
+#endif
+
+/* Messages carrying the same payload to several components (an input slice to the crossbars
+   of every column group, an activation output to all of its consumers) cross the source
+   port and link once and are copied where the paths split: 0-one unicast per destination */
+#ifndef MULTICAST
+#define MULTICAST 0
+#endif
+
+constexpr uint32_t RLE_RUN_BITS = 4;
+
+/* Spiking mode: activations fire binary spikes over SNN_TIMESTEPS timesteps, a neuron
+   fires in a timestep with probability SNN_FIRING_RATE and links carry address events by default.
+   Traffic totals cover all timesteps. 0-dense frames of BIT_PRECISION bit planes */
+#ifndef SNN_TIMESTEPS
+#define SNN_TIMESTEPS 0
+#endif
+
+#ifndef SNN_FIRING_RATE
+#define SNN_FIRING_RATE 0.1
+#endif
+
+/* Network graph: 0-every component and message, 1-one node per layer and component
+   type, edges colored by the bits they carry */
+#ifndef DOT_SUMMARY
+#define DOT_SUMMARY 0
+#endif
+
+/* Multi-chip board: CHIP_NUM chips holding at most CHIP_CROSSBARS crossbars each (0-unlimited) */
+#ifndef CHIP_NUM
+#define CHIP_NUM 1
+#endif
+
+#ifndef CHIP_CROSSBARS
+#define CHIP_CROSSBARS 0
+#endif
+
+/* Inter-chip link: bits per unit time and unit times per transfer */
+#ifndef CHIP_LINK_BW
+#define CHIP_LINK_BW 256
+#endif
+
+#ifndef CHIP_LINK_LATENCY
+#define CHIP_LINK_LATENCY 10
+#endif
+
+/* Worker threads for the crossbars of one large layer: 0-one per core, 1-serial */
+#ifndef SIM_THREADS
+#define SIM_THREADS 0
+#endif
+
+/* Crossbars a layer needs before its construction and sends are split across the workers */
+#ifndef PARALLEL_CROSSBARS
+#define PARALLEL_CROSSBARS 4096
+#endif
+
+/* Builds each layer only when it is about to run or receive, and releases its components
+   and links once it has sent its output, keeping only its delay and statistics: 0-every layer
+   stays alive until the end. Single chip, without incremental updates */
+#ifndef STREAM_LAYERS
+#define STREAM_LAYERS 0
+#endif
+
+/* Packet groups buffered between the im2col, crossbar, accumulator and activation
+   stages of a layer, a stage starts on group k+1 while the next one works on k: 0-serial stages.
+   A group is one bit plane of a window, or a whole window for a stage that needs all its planes */
+#ifndef PIPELINE_DEPTH
+#define PIPELINE_DEPTH 0
+#endif
+
+/* On-chip SRAM buffer at every layer boundary: bits it holds, 0-layers send to each other directly */
+#ifndef BUFFER_BITS
+#define BUFFER_BITS 0
+#endif
+
+/* Buffer banks and the bits per unit time every bank writes and reads */
+#ifndef BUFFER_BANKS
+#define BUFFER_BANKS 4
+#endif
+
+#ifndef BUFFER_WRITE_BW
+#define BUFFER_WRITE_BW 256
+#endif
+
+#ifndef BUFFER_READ_BW
+#define BUFFER_READ_BW 256
+#endif
+
+/* Host DRAM the model input is read from and the output written to: bits per unit time
+   of every channel, 0-free host I/O */
+#ifndef DRAM_BW
+#define DRAM_BW 0
+#endif
+
+#ifndef DRAM_CHANNELS
+#define DRAM_CHANNELS 2
+#endif
+
+/* Bits of one DRAM burst, transfers are rounded up to whole bursts */
+#ifndef DRAM_BURST_BITS
+#define DRAM_BURST_BITS 512
+#endif
+
+/* Unit time from a DRAM request to its first burst */
+#ifndef DRAM_LATENCY
+#define DRAM_LATENCY 50
+#endif
+
+/* Physical crossbar pool shared by all layers, 0 keeps every layer resident */
+#ifndef CROSSBAR_POOL
+#define CROSSBAR_POOL 0
+#endif
+
+/* Weight programming: bits per unit time written into the pool, unit times per crossbar row */
+#ifndef WRITE_BW
+#define WRITE_BW 1024
+#endif
+
+#ifndef ROW_PROGRAM_LATENCY
+#define ROW_PROGRAM_LATENCY 1
+#endif
+
 constexpr uint32_t UNIT_TIME = 1;
 constexpr uint32_t UNIT_ADDR = 0x10;
+constexpr uint32_t CHIP_ADDR_SPAN = 0x1000000;  // address range of one chip
 
 /* Bandwidth */
 #ifndef BANDWIDTH
 #define BANDWIDTH 2048*2048
 #endif
 
-constexpr uint32_t HOST_BW = std::numeric_limits<uint32_t>::max();
-
 // Network Bandwidth
 constexpr uint32_t CB_ACC_BW  = BANDWIDTH;
 constexpr uint32_t ACC_ACT_BW = BANDWIDTH;
-constexpr uint32_t ACT_CB_BW  = BANDWIDTH;
 
 constexpr uint32_t IM_CB_BW = BANDWIDTH;
 
 constexpr uint32_t LAYER_BW = BANDWIDTH;
 
-// Component Bandwidth
-constexpr uint32_t CB_IN_BW        = CROSSBAR_SIZE; 
-constexpr uint32_t CB_OUT_BW       = CROSSBAR_SIZE; 
-constexpr uint32_t ACC_IN_BW       = ACC_SIZE; 
-constexpr uint32_t ACC_OUT_BW      = ACC_SIZE; 
-constexpr uint32_t ACT_IN_BW       = ACT_SIZE; 
-constexpr uint32_t ACT_OUT_BW      = ACT_SIZE; 
-constexpr uint32_t IM_IN_BW        = BANDWIDTH;
-constexpr uint32_t IM_OUT_BW       = BANDWIDTH;
-constexpr uint32_t POOL_IN_BW      = BANDWIDTH;
-constexpr uint32_t POOL_OUT_BW     = BANDWIDTH;
-constexpr uint32_t FLATTEN_IN_BW   = BANDWIDTH;
-constexpr uint32_t FLATTEN_OUT_BW  = BANDWIDTH;
\ No newline at end of file
+// Link classes whose bandwidth can be changed per simulation
+enum LinkClass { CB_ACC, ACC_ACT, IM_CB, LAYER, LINK_CLASS_NUM };
+
+using ClassBandwidths = std::array<uint32_t, LINK_CLASS_NUM>;
+
+// Parameters that can change between simulations in one process, the
+// macros above are their defaults
+struct SimConfig {
+    uint32_t crossbar_size = CROSSBAR_SIZE;     // also the accumulator and activation width
+    uint32_t bit_precision = BIT_PRECISION;
+    uint32_t conv_mapping = CONV_MAPPING;
+    uint32_t bandwidth = BANDWIDTH;             // im2col, pooling, flatten and merge ports
+    ClassBandwidths class_bandwidth = {CB_ACC_BW, ACC_ACT_BW, IM_CB_BW, LAYER_BW};
+};
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "dgraph_logger.hpp"
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
-DotGraphLogger::DotGraphLogger(const std::string& filename) {
+DotGraphLogger::DotGraphLogger(const std::string& filename, bool summary): summary(summary) {
+    if (filename.empty()) return;   // logging disabled
     dotFile.open(filename);
     dotFile << "digraph InterconnectGraph {\n";
 }
@@ -17,7 +19,10 @@ std::string DotGraphLogger::formatNode(uint32_t address, const std::string& type
     return ss.str();
 }
 
+bool DotGraphLogger::isEnabled() const { return dotFile.is_open(); }
+
 void DotGraphLogger::addNode(uint32_t address, const std::string& type) {
+    if (!dotFile.is_open()) return;
     std::string nodeLabel = formatNode(address, type);
     if (nodes.find(nodeLabel) == nodes.end()) {
         dotFile << "  \"" << nodeLabel << "\";\n";
@@ -25,9 +30,33 @@ void DotGraphLogger::addNode(uint32_t address, const std::string& type) {
     }
 }
 
+size_t DotGraphLogger::groupOf(uint32_t address, const std::string& type) {
+    auto it = group_of.find(address);
+    if (it != group_of.end()) return it->second;
+    // Components registered without a layer, like the host
+    addComponent(address, type, -1);
+    return group_of[address];
+}
+
+void DotGraphLogger::addComponent(uint32_t address, const std::string& type, int layer) {
+    if (!dotFile.is_open() || !summary) return;
+    auto [it, added] = group_index.insert({{layer, type}, groups.size()});
+    if (added) groups.push_back({layer, type});
+    groups[it->second].count++;
+    group_of[address] = it->second;
+}
+
 void DotGraphLogger::addEdge(uint32_t from, const std::string& fromType,
                              uint32_t to, const std::string& toType,
-                             uint32_t sizeBits, uint32_t times) {
+                             uint32_t sizeBits, uint32_t times, uint32_t delay) {
+    if (!dotFile.is_open()) return;
+    if (summary) {
+        Flow& flow = flows[{groupOf(from, fromType), groupOf(to, toType)}];
+        flow.bits += static_cast<uint64_t>(sizeBits) * times;
+        flow.messages++;
+        flow.delay += delay;
+        return;
+    }
     std::string fromNode = formatNode(from, fromType);
     std::string toNode = formatNode(to, toType);
 
@@ -38,7 +67,44 @@ void DotGraphLogger::addEdge(uint32_t from, const std::string& fromType,
             << "\" [label=\"" << std::dec << times << "x " << std::dec << sizeBits << " bits\"];\n";
 }
 
+// One cluster per layer; edge width and color go from cold blue to hot red
+// with the bits carried, the label adds the share of all link time
+void DotGraphLogger::writeSummary() {
+    std::map<int, std::vector<size_t>> layers;
+    for (size_t g = 0; g < groups.size(); g++) layers[groups[g].layer].push_back(g);
+    for (auto& [layer, members]: layers) {
+        std::string indent = "  ";
+        if (layer >= 0) {
+            dotFile << "  subgraph cluster_" << layer << " {\n    label=\"Layer " << layer << "\";\n";
+            indent = "    ";
+        }
+        for (size_t g: members) {
+            dotFile << indent << "g" << g << " [label=\"" << groups[g].type;
+            if (groups[g].count > 1) dotFile << " x" << groups[g].count;
+            dotFile << "\"];\n";
+        }
+        if (layer >= 0) dotFile << "  }\n";
+    }
+
+    uint64_t max_bits = 1, total_delay = 0;
+    for (auto& [ends, flow]: flows) {
+        max_bits = std::max(max_bits, flow.bits);
+        total_delay += flow.delay;
+    }
+    for (auto& [ends, flow]: flows) {
+        double heat = static_cast<double>(flow.bits) / max_bits;
+        double delay_share = total_delay ? 100.0 * flow.delay / total_delay : 0;
+        dotFile << "  g" << ends.first << " -> g" << ends.second << " [label=\"" << flow.bits << " bits, "
+                << flow.messages << " msgs, " << std::fixed << std::setprecision(1) << delay_share << "% time\""
+                << ", penwidth=" << std::setprecision(2) << 1 + 7 * heat
+                << ", color=\"" << std::setprecision(3) << 0.66 * (1 - heat) << " 1 0.9\"];\n";
+        dotFile.unsetf(std::ios::floatfield);
+    }
+}
+
 void DotGraphLogger::finalize() {
+    if (!dotFile.is_open()) return;
+    if (summary) writeSummary();
     dotFile << "}\n";
     dotFile.close();
 }
\ No newline at end of file
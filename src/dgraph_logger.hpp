@@ -1,22 +1,50 @@
 #pragma once
 #include <fstream>
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 class DotGraphLogger {
 private:
     std::ofstream dotFile;
     std::unordered_set<std::string> nodes;
 
+    // Summary graph: components of one layer and type form a group, the
+    // messages between two groups one edge
+    struct Group {
+        int layer;
+        std::string type;
+        uint32_t count = 0;
+    };
+    struct Flow {
+        uint64_t bits = 0;
+        uint64_t messages = 0;
+        uint64_t delay = 0;     // summed link time of the messages
+    };
+    bool summary = false;
+    std::vector<Group> groups;
+    std::map<std::pair<int, std::string>, size_t> group_index;
+    std::unordered_map<uint32_t, size_t> group_of;
+    std::map<std::pair<size_t, size_t>, Flow> flows;
+
     std::string formatNode(uint32_t address, const std::string& type) const;
+    size_t groupOf(uint32_t address, const std::string& type);
+    void writeSummary();
 
 public:
-    DotGraphLogger(const std::string& filename);
+    // An empty filename disables logging. A summary graph clusters the
+    // components by layer and colors its edges by the bits they carry.
+    DotGraphLogger(const std::string& filename, bool summary = false);
     ~DotGraphLogger();
 
+    bool isEnabled() const;
     void addNode(uint32_t address, const std::string& type);
+    // Layer of a new component, -1 for none
+    void addComponent(uint32_t address, const std::string& type, int layer);
     void addEdge(uint32_t from, const std::string& fromType,
                  uint32_t to, const std::string& toType,
-                 uint32_t sizeBits, uint32_t times);
+                 uint32_t sizeBits, uint32_t times, uint32_t delay = 0);
     void finalize();
-};
\ No newline at end of file
+};
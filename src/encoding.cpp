@@ -0,0 +1,70 @@
+#include "encoding.hpp"
+#include "configuration.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static uint32_t nonzeros(uint32_t size_bits, double density) {
+    return static_cast<uint32_t>(std::ceil(size_bits * density));
+}
+
+static uint32_t index_bits(uint32_t size_bits) {
+    uint32_t bits = 1;
+    while ((1ull << bits) < size_bits) bits++;
+    return bits;
+}
+
+static uint32_t with_metadata(uint32_t payload, uint64_t metadata, uint32_t planes) {
+    if (planes == 0) return payload;
+    return payload + static_cast<uint32_t>((metadata + planes - 1) / planes);
+}
+
+uint32_t DenseEncoding::encode(uint32_t size_bits, uint32_t /*planes*/, double /*density*/) {
+    return size_bits;
+}
+std::string DenseEncoding::getType() { return "Dense"; }
+
+uint32_t BitmapEncoding::encode(uint32_t size_bits, uint32_t planes, double density) {
+    return with_metadata(nonzeros(size_bits, density), size_bits, planes);
+}
+std::string BitmapEncoding::getType() { return "Bitmap"; }
+
+RunLengthEncoding::RunLengthEncoding(uint32_t run_bits): run_bits(run_bits) {}
+
+uint32_t RunLengthEncoding::encode(uint32_t size_bits, uint32_t planes, double density) {
+    uint32_t nnz = nonzeros(size_bits, density);
+    // Zero runs longer than the run field can count need an extra (zero) token
+    uint64_t max_run = (1ull << run_bits) - 1;
+    uint64_t zeros = size_bits - nnz;
+    uint64_t runs = std::max<uint64_t>(nnz, 1);
+    uint64_t extra = runs * ((zeros / runs) / (max_run + 1));
+    uint64_t tokens = nnz + extra;
+    // Each token carries its value bit in every plane and its run length once
+    return with_metadata(static_cast<uint32_t>(tokens), tokens * run_bits, planes);
+}
+std::string RunLengthEncoding::getType() { return "Run-Length"; }
+
+uint32_t CsrEncoding::encode(uint32_t size_bits, uint32_t planes, double density) {
+    uint32_t nnz = nonzeros(size_bits, density);
+    uint32_t idx = index_bits(size_bits + 1);
+    return with_metadata(nnz, static_cast<uint64_t>(nnz + 1) * idx, planes);
+}
+std::string CsrEncoding::getType() { return "CSR"; }
+
+uint32_t AddressEventEncoding::encode(uint32_t size_bits, uint32_t /*planes*/, double density) {
+    return nonzeros(size_bits, density) * index_bits(size_bits);
+}
+std::string AddressEventEncoding::getType() { return "Address-Event"; }
+
+std::unique_ptr<LinkEncoding> makeLinkEncoding(uint32_t id) {
+    switch (id) {
+        case 0: return std::make_unique<DenseEncoding>();
+        case 1: return std::make_unique<BitmapEncoding>();
+        case 2: return std::make_unique<RunLengthEncoding>(RLE_RUN_BITS);
+        case 3: return std::make_unique<CsrEncoding>();
+        case 4: return std::make_unique<AddressEventEncoding>();
+        default:
+            fail("Unknown link encoding: ", id);
+    }
+}
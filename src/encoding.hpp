@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Wire format for sparse activation payloads. encode() returns the bits per
+// transfer (bit plane) once `size_bits` values with the given nonzero
+// density are compressed. Every value carries one bit in each of the
+// `planes` transfers of its vector; metadata is sent once per vector and
+// spread over those planes.
+class LinkEncoding {
+    public:
+    virtual uint32_t encode(uint32_t size_bits, uint32_t planes, double density) = 0;
+    virtual std::string getType() = 0;
+    virtual ~LinkEncoding() {}
+};
+
+// Plain values, zeros included
+class DenseEncoding: public LinkEncoding {
+    public:
+    uint32_t encode(uint32_t size_bits, uint32_t planes, double density) override;
+    std::string getType() override;
+};
+
+// Nonzero values plus a one-bit-per-value presence mask
+class BitmapEncoding: public LinkEncoding {
+    public:
+    uint32_t encode(uint32_t size_bits, uint32_t planes, double density) override;
+    std::string getType() override;
+};
+
+// Nonzero values each tagged with the length of the zero run before them
+class RunLengthEncoding: public LinkEncoding {
+    private:
+    uint32_t run_bits;
+    public:
+    RunLengthEncoding(uint32_t run_bits);
+    uint32_t encode(uint32_t size_bits, uint32_t planes, double density) override;
+    std::string getType() override;
+};
+
+// Nonzero values with their column index and one row pointer per packet
+class CsrEncoding: public LinkEncoding {
+    public:
+    uint32_t encode(uint32_t size_bits, uint32_t planes, double density) override;
+    std::string getType() override;
+};
+
+// One event per spike, carrying the address of the neuron that fired
+class AddressEventEncoding: public LinkEncoding {
+    public:
+    uint32_t encode(uint32_t size_bits, uint32_t planes, double density) override;
+    std::string getType() override;
+};
+
+// 0-dense, 1-bitmap, 2-run-length, 3-CSR, 4-address events
+std::unique_ptr<LinkEncoding> makeLinkEncoding(uint32_t id);
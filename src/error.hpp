@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Invalid models and configurations end the simulation. The command line
+// tools print the message and exit; inside a ThrowErrors scope, as in the C
+// library, the message is thrown as a SimulationError instead.
+class SimulationError: public std::runtime_error {
+    public:
+    using std::runtime_error::runtime_error;
+};
+
+inline thread_local bool throw_errors = false;
+
+// Errors on the calling thread throw until the scope ends
+class ThrowErrors {
+    private:
+    bool previous = throw_errors;
+
+    public:
+    ThrowErrors() { throw_errors = true; }
+    ~ThrowErrors() { throw_errors = previous; }
+};
+
+[[noreturn]] inline void failWith(const std::string& message) {
+    if (throw_errors) throw SimulationError(message);
+    std::cout << message << std::endl;
+    exit(1);
+}
+
+template <typename... Parts>
+[[noreturn]] void fail(const Parts&... parts) {
+    std::ostringstream message;
+    (message << ... << parts);
+    failWith(message.str());
+}
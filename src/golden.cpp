@@ -0,0 +1,238 @@
+#include "networks.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// Regression check against the archived sweep results. Every archived
+// configuration is simulated again and its delay, crossbar amount, usage and
+// total bits are compared with the stored report. Archives written by older
+// simulator versions differ for known reasons; their current values are
+// pinned in golden_diffs.txt, so only unexplained changes fail.
+//
+// Usage: ./golden [--update]     --update pins the current values of every file that differs
+
+namespace fs = std::filesystem;
+
+const std::string KNOWN_DIFFS = "golden_diffs.txt";
+
+struct Archive {
+    std::string dir;
+    std::function<void(Model&)> build;
+    uint32_t conv_mapping;
+    std::string note;       // why older files may not match
+};
+
+// Report fields in the format writeReport() prints them
+struct Result {
+    std::string delay, crossbars, usage, bits;
+
+    bool operator==(const Result& other) const {
+        return delay == other.delay && crossbars == other.crossbars && usage == other.usage && bits == other.bits;
+    }
+};
+
+Result readReport(const fs::path& file) {
+    std::ifstream in(file);
+    std::map<std::string, std::string> fields;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t colon = line.find(": ");
+        if (colon != std::string::npos) fields[line.substr(0, colon)] = line.substr(colon + 2);
+    }
+    auto number = [](const std::string& value) { return value.substr(0, value.find(' ')); };
+    return {number(fields["Delay"]), fields["Crossbar Amount"], fields["Crossbar Usage Proportion"],
+            number(fields["Total Bits transferred"])};
+}
+
+// The compared fields of a finished simulation
+Result measure(Simulation& simulation) {
+    Interconnect& interconnect = simulation.getInterconnect();
+    double valid_area = interconnect.getCrossbarUsage() * interconnect.getCrossbarNum();
+    std::ostringstream usage;
+    usage << valid_area / interconnect.getCrossbarNum();
+    return {std::to_string(simulation.getModel().get_delay()), std::to_string(interconnect.getCrossbarNum()),
+            usage.str(), std::to_string(interconnect.getTotalBits())};
+}
+
+// File names are <crossbar size>-<bit precision>[-<bandwidth>].txt
+Result simulate(const Archive& archive, const fs::path& file) {
+    std::vector<uint32_t> values;
+    std::stringstream name(file.stem().string());
+    std::string value;
+    while (std::getline(name, value, '-')) values.push_back(std::stoul(value));
+    if (values.size() < 2) {
+        std::cout << "Unknown archive file name: " << file << std::endl;
+        exit(1);
+    }
+
+    SimConfig config;
+    config.crossbar_size = values[0];
+    config.bit_precision = values[1];
+    config.conv_mapping = archive.conv_mapping;
+    if (values.size() > 2) {
+        config.bandwidth = values[2];
+        config.class_bandwidth.fill(values[2]);
+    }
+
+    Simulation simulation({28, 28, 1}, "", config);
+    archive.build(simulation.getModel());
+    simulation.getModel().forward();
+    return measure(simulation);
+}
+
+// One line per pinned file: path, delay, crossbars, usage, total bits
+std::map<std::string, Result> loadKnownDiffs() {
+    std::map<std::string, Result> known;
+    std::ifstream in(KNOWN_DIFFS);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string path;
+        Result result;
+        if (!(fields >> path >> result.delay >> result.crossbars >> result.usage >> result.bits)) {
+            std::cout << "Corrupted known difference in " << KNOWN_DIFFS << ": " << line << std::endl;
+            exit(1);
+        }
+        known[path] = result;
+    }
+    return known;
+}
+
+void saveKnownDiffs(const std::vector<Archive>& archives, const std::map<std::string, Result>& known) {
+    std::ofstream out(KNOWN_DIFFS);
+    out << "# Archived results the current simulator does not reproduce, written by ./golden --update\n"
+        << "# path delay crossbars usage total_bits (current values)\n";
+    for (auto& archive: archives) out << "# " << archive.dir << ": " << archive.note << "\n";
+    for (auto& [path, result]: known) {
+        out << path << " " << result.delay << " " << result.crossbars << " " << result.usage << " " << result.bits << "\n";
+    }
+}
+
+std::string describe(const Result& result) {
+    return "delay " + result.delay + ", crossbars " + result.crossbars + ", usage " + result.usage + ", bits " + result.bits;
+}
+
+// Model::update() after a bandwidth edit and then a sparsity edit has to give
+// what a fresh forward() of the edited model gives. Returns the mismatches.
+uint32_t checkUpdates() {
+    // Bitmap encoded links, so sparsity changes the traffic
+    auto build = [](Simulation& s) {
+        s.getInterconnect().setEncoding(makeLinkEncoding(1));
+        s.getModel().Conv(3, 3, 32).MaxPool(2, 2).As("pooled").Conv(3, 3, 64).MaxPool(2, 2).Conv(3, 3, 64)
+                    .Flatten().Dense(64).Dense(10);
+    };
+    SimConfig config;
+    config.conv_mapping = 1;
+    config.bandwidth = 64;
+    config.class_bandwidth.fill(64);
+
+    Simulation tracked({28, 28, 1}, "", config);
+    tracked.getInterconnect().setTracking(true);
+    build(tracked);
+    tracked.getModel().forward();
+    auto [source, destination, bandwidth] = tracked.getInterconnect().getLinks().front();
+    const std::vector<std::pair<std::string, std::function<void(Simulation&)>>> edits = {
+        {"bandwidth", [&, source = source, destination = destination](Simulation& s) { s.getInterconnect().updateBandWidth(source, destination, 1); }},
+        {"sparsity", [](Simulation& s) { s.getModel().set_sparsity("pooled", 0.5); }},
+    };
+
+    uint32_t mismatches = 0;
+    for (size_t i = 0; i < edits.size(); i++) {
+        edits[i].second(tracked);
+        tracked.getModel().update();
+        Simulation fresh({28, 28, 1}, "", config);
+        build(fresh);
+        for (size_t j = 0; j <= i; j++) edits[j].second(fresh);
+        fresh.getModel().forward();
+        Result updated = measure(tracked), expected = measure(fresh);
+        if (!(updated == expected)) {
+            mismatches++;
+            std::cout << "  update after the " << edits[i].first << " edit\n"
+                      << "    fresh:   " << describe(expected) << "\n"
+                      << "    updated: " << describe(updated) << "\n";
+        }
+    }
+    std::cout << "incremental updates: " << edits.size() << " edits, " << mismatches << " regressions" << std::endl;
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    bool update = argc > 1 && std::string(argv[1]) == "--update";
+    setTrace(false);
+
+    const std::string old_delay = "delay model before per-port bandwidth";
+    const std::string old_flatten = "CNN archives predate the Flatten fix, the Dense after it saw only the channel count, "
+                                    "and took the last im2col and pooling slice as the stage delay";
+    const std::vector<Archive> archives = {
+        {"old_data/fc", [](Model& m) { buildMLP(m, 32); }, CONV_MAPPING, old_delay},
+        {"old_data/cnn-k2col", buildCNN, 0, old_flatten},
+        {"old_data/cnn-im2col", buildCNN, 1, old_flatten},
+        {"old_results/fc", [](Model& m) { buildMLP(m, 64); }, CONV_MAPPING, old_delay},
+        {"old_results/cnn-k2col", buildCNN, 0, old_flatten},
+        {"old_results/cnn-im2col", buildCNN, 1, old_flatten},
+        {"var_network_bw/cnn-k2col", buildCNN, 0, "delay model before crossbar port bandwidth; " + old_flatten},
+        {"var_network_bw/cnn-im2col", buildCNN, 1, "delay model before crossbar port bandwidth; " + old_flatten},
+        {"var_network_bw_with_cp_bw/fc", [](Model& m) { buildMLP(m, 32); }, CONV_MAPPING, "written by the current simulator"},
+        {"var_network_bw_with_cp_bw/cnn-k2col", buildCNN, 0, old_flatten},
+        {"var_network_bw_with_cp_bw/cnn-im2col", buildCNN, 1, old_flatten},
+    };
+
+    std::map<std::string, Result> known = loadKnownDiffs();
+    std::map<std::string, Result> differing;
+    uint32_t regressions = 0;
+    for (auto& archive: archives) {
+        if (!fs::exists(archive.dir)) continue;
+        std::vector<fs::path> files;
+        for (auto& entry: fs::directory_iterator(archive.dir)) {
+            if (entry.path().extension() == ".txt") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+
+        uint32_t same = 0, pinned = 0, failed = 0;
+        for (auto& file: files) {
+            std::string path = file.generic_string();
+            Result archived = readReport(file);
+            Result current = simulate(archive, file);
+            if (current == archived) {
+                same++;
+                continue;
+            }
+            differing[path] = current;
+            auto it = known.find(path);
+            if (it != known.end() && it->second == current) {
+                pinned++;
+            } else if (!update) {
+                failed++;
+                std::cout << "  " << path << "\n"
+                          << "    archived: " << describe(archived) << "\n";
+                if (it != known.end()) std::cout << "    pinned:   " << describe(it->second) << "\n";
+                std::cout << "    current:  " << describe(current) << "\n";
+            }
+        }
+        std::cout << archive.dir << ": " << files.size() << " files, " << same << " match, "
+                  << pinned << " known differences, " << failed << " regressions" << std::endl;
+        regressions += failed;
+    }
+
+    regressions += checkUpdates();
+
+    if (update) {
+        saveKnownDiffs(archives, differing);
+        std::cout << "Pinned " << differing.size() << " files in " << KNOWN_DIFFS << std::endl;
+        return 0;
+    }
+    // Pins of files that match the archive again are stale as well
+    for (auto& [path, result]: known) {
+        if (!differing.count(path)) {
+            std::cout << "  " << path << " matches its archive again, run ./golden --update" << std::endl;
+            regressions++;
+        }
+    }
+    if (regressions) {
+        std::cout << regressions << " regressions!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
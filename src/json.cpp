@@ -0,0 +1,209 @@
+#include "json.hpp"
+#include "error.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
+namespace {
+
+class JsonParser {
+    private:
+    const std::string& text;
+    size_t pos = 0;
+
+    void fail(const std::string& message) {
+        ::fail("JSON parse error at offset ", pos, ": ", message);
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+
+    void expect(char c) {
+        skipSpace();
+        if (pos >= text.size() || text[pos] != c) fail(std::string("expected '") + c + "'");
+        pos++;
+    }
+
+    bool match(const std::string& word) {
+        if (text.compare(pos, word.size(), word) == 0) {
+            pos += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    std::string parseString() {
+        expect('"');
+        std::string out;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\') {
+                if (pos >= text.size()) break;
+                char e = text[pos++];
+                switch (e) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': out += '?'; pos += 4; break;   // names in model files are ASCII
+                    default: out += e; break;
+                }
+            } else {
+                out += c;
+            }
+        }
+        if (pos >= text.size()) fail("unterminated string");
+        pos++;
+        return out;
+    }
+
+    public:
+    JsonParser(const std::string& text): text(text) {}
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos >= text.size()) fail("unexpected end of input");
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            value.kind = JsonValue::Kind::Object;
+            pos++;
+            skipSpace();
+            if (text[pos] == '}') { pos++; return value; }
+            while (1) {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.object[key] = parseValue();
+                skipSpace();
+                if (text[pos] == ',') { pos++; continue; }
+                expect('}');
+                break;
+            }
+        } else if (c == '[') {
+            value.kind = JsonValue::Kind::Array;
+            pos++;
+            skipSpace();
+            if (text[pos] == ']') { pos++; return value; }
+            while (1) {
+                value.array.push_back(parseValue());
+                skipSpace();
+                if (text[pos] == ',') { pos++; continue; }
+                expect(']');
+                break;
+            }
+        } else if (c == '"') {
+            value.kind = JsonValue::Kind::String;
+            value.str = parseString();
+        } else if (match("true")) {
+            value.kind = JsonValue::Kind::Bool;
+            value.boolean = true;
+        } else if (match("false")) {
+            value.kind = JsonValue::Kind::Bool;
+        } else if (match("null")) {
+            value.kind = JsonValue::Kind::Null;
+        } else {
+            const char* begin = text.c_str() + pos;
+            char* end = nullptr;
+            value.kind = JsonValue::Kind::Number;
+            value.number = std::strtod(begin, &end);
+            if (end == begin) fail("unexpected character");
+            pos += end - begin;
+        }
+        return value;
+    }
+
+    void finish() {
+        skipSpace();
+        if (pos != text.size()) fail("trailing characters");
+    }
+};
+
+const JsonValue null_value;
+
+}
+
+bool JsonValue::has(const std::string& key) const {
+    return kind == Kind::Object && object.find(key) != object.end();
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    auto it = object.find(key);
+    if (it == object.end()) return null_value;
+    return it->second;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    if (index >= array.size()) return null_value;
+    return array[index];
+}
+
+size_t JsonValue::size() const {
+    return kind == Kind::Object ? object.size() : array.size();
+}
+
+uint32_t JsonValue::asUint() const {
+    if (kind != Kind::Number || number < 0) {
+        fail("JSON value is not an unsigned number!");
+    }
+    return static_cast<uint32_t>(number);
+}
+
+double JsonValue::asNumber() const {
+    if (kind != Kind::Number) {
+        fail("JSON value is not a number!");
+    }
+    return number;
+}
+
+const std::string& JsonValue::asString() const {
+    if (kind != Kind::String) {
+        fail("JSON value is not a string!");
+    }
+    return str;
+}
+
+bool JsonValue::asBool() const {
+    if (kind != Kind::Bool) {
+        fail("JSON value is not a boolean!");
+    }
+    return boolean;
+}
+
+uint32_t JsonValue::getUint(const std::string& key, uint32_t fallback) const {
+    return has(key) ? (*this)[key].asUint() : fallback;
+}
+
+double JsonValue::getNumber(const std::string& key, double fallback) const {
+    return has(key) ? (*this)[key].asNumber() : fallback;
+}
+
+std::string JsonValue::getString(const std::string& key, const std::string& fallback) const {
+    return has(key) ? (*this)[key].asString() : fallback;
+}
+
+bool JsonValue::getBool(const std::string& key, bool fallback) const {
+    return has(key) ? (*this)[key].asBool() : fallback;
+}
+
+JsonValue parseJson(const std::string& text) {
+    JsonParser parser(text);
+    JsonValue value = parser.parseValue();
+    parser.finish();
+    return value;
+}
+
+JsonValue parseJsonFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        fail("Cannot open file: ", filename);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return parseJson(buffer.str());
+}
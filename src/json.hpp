@@ -0,0 +1,37 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Minimal JSON document model, enough for model description files
+class JsonValue {
+public:
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string str;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    bool has(const std::string& key) const;
+    const JsonValue& operator[](const std::string& key) const;
+    const JsonValue& operator[](size_t index) const;
+    size_t size() const;
+
+    uint32_t asUint() const;
+    double asNumber() const;
+    const std::string& asString() const;
+    bool asBool() const;
+
+    uint32_t getUint(const std::string& key, uint32_t fallback) const;
+    double getNumber(const std::string& key, double fallback) const;
+    std::string getString(const std::string& key, const std::string& fallback) const;
+    bool getBool(const std::string& key, bool fallback) const;
+};
+
+JsonValue parseJson(const std::string& text);
+
+JsonValue parseJsonFile(const std::string& filename);
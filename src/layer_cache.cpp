@@ -0,0 +1,87 @@
+#include "layer_cache.hpp"
+#include "error.hpp"
+#include <fstream>
+#include <sstream>
+
+const LayerResult* LayerCache::find(const std::string& key) {
+    lookups++;
+    auto it = results.find(key);
+    if (it == results.end()) return nullptr;
+    hits++;
+    return &it->second;
+}
+
+void LayerCache::insert(const std::string& key, const LayerResult& result) {
+    results[key] = result;
+}
+
+// Written first, files of any other format are rejected rather than misread
+static const std::string FORMAT = "layer-cache 3";
+
+// A format line, then one entry per line: key, then the result fields separated by tabs
+void LayerCache::load(const std::string& filename) {
+    std::ifstream file(filename);
+    std::string line;
+    if (!std::getline(file, line)) return;
+    if (line != FORMAT) {
+        fail("Layer cache ", filename, " is not in the ", FORMAT, " format, delete it to start a new one");
+    }
+    while (std::getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            fail("Corrupted layer cache entry in ", filename);
+        }
+        std::istringstream fields(line.substr(tab + 1));
+        LayerResult result;
+        size_t count = 0;
+        fields >> result.delay >> result.traffic.total_bits >> result.traffic.raw_bits
+               >> result.traffic.reuse_bits_saved >> result.traffic.line_buffer_bits
+               >> result.traffic.min_bandwidth >> count;
+        result.activations.resize(count);
+        for (auto& act: result.activations) fields >> act.first >> act.second;
+        fields >> result.windows >> count;
+        result.stages.resize(count);
+        for (auto& stage: result.stages) {
+            fields >> stage.delay >> stage.packets >> stage.whole_windows >> count;
+            stage.weights.resize(fields ? count : 0);
+            for (auto& weight: stage.weights) fields >> weight;
+        }
+        fields >> result.traffic.multicast_bits_saved >> result.traffic.multicast_time_saved >> count;
+        result.critical_sends.resize(count);
+        for (auto& send: result.critical_sends) {
+            fields >> send.stage >> send.source >> send.destination >> send.bits >> send.bandwidth
+                   >> send.time >> send.runner_up >> send.has_runner_up;
+        }
+        if (!fields) {
+            fail("Corrupted layer cache entry in ", filename);
+        }
+        results[line.substr(0, tab)] = result;
+    }
+}
+
+void LayerCache::save(const std::string& filename) {
+    std::ofstream file(filename);
+    file << FORMAT << "\n";
+    for (auto& [key, result]: results) {
+        file << key << "\t" << result.delay << " " << result.traffic.total_bits << " " << result.traffic.raw_bits
+             << " " << result.traffic.reuse_bits_saved << " " << result.traffic.line_buffer_bits
+             << " " << result.traffic.min_bandwidth << " " << result.activations.size();
+        for (auto& act: result.activations) file << " " << act.first << " " << act.second;
+        file << " " << result.windows << " " << result.stages.size();
+        for (auto& stage: result.stages) {
+            file << " " << stage.delay << " " << stage.packets << " " << stage.whole_windows << " " << stage.weights.size();
+            for (auto weight: stage.weights) file << " " << weight;
+        }
+        file << " " << result.traffic.multicast_bits_saved << " " << result.traffic.multicast_time_saved;
+        file << " " << result.critical_sends.size();
+        for (auto& send: result.critical_sends) {
+            file << " " << send.stage << " " << send.source << " " << send.destination << " " << send.bits
+                 << " " << send.bandwidth << " " << send.time << " " << send.runner_up << " " << send.has_runner_up;
+        }
+        file << "\n";
+    }
+}
+
+size_t LayerCache::size() { return results.size(); }
+uint64_t LayerCache::getLookups() { return lookups; }
+uint64_t LayerCache::getHits() { return hits; }
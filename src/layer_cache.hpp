@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "components.hpp"
+
+// A stage inside a layer. Its delay is split over the packet groups that
+// PIPELINE_DEPTH overlaps: first over the windows by weight, then evenly over
+// the packets of a window.
+struct PipelineStage {
+    uint32_t delay = 0;
+    uint32_t packets = 1;           // packets of one window, e.g. its bit planes
+    bool whole_windows = false;     // starts a window once the stage before finished all of it
+    std::vector<uint32_t> weights;  // work of every window, empty when they are all equal
+};
+
+// What a layer's internal crossbar -> accumulator -> activation transfers
+// produced, replayed on a hit instead of simulating them again
+struct LayerResult {
+    uint32_t delay = 0;
+    TrafficTotals traffic;
+    std::vector<std::pair<uint32_t, uint32_t>> activations;    // bits and times every activation unit received
+    std::vector<PipelineStage> stages;                          // every stage inside the layer
+    uint32_t windows = 1;                                       // windows the stages split their packets over
+    std::vector<CriticalSend> critical_sends;                   // addresses relative to the layer's first crossbar
+};
+
+// Layer results keyed by layer kind, shapes and every parameter the internal
+// transfers depend on, shared by all simulations of a sweep
+class LayerCache {
+    private:
+    std::unordered_map<std::string, LayerResult> results;
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+
+    public:
+    const LayerResult* find(const std::string& key);
+    void insert(const std::string& key, const LayerResult& result);
+
+    // A missing or empty file leaves the cache empty, one of another format fails
+    void load(const std::string& filename);
+    void save(const std::string& filename);
+
+    size_t size();
+    uint64_t getLookups();
+    uint64_t getHits();
+};
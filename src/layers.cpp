@@ -1,20 +1,80 @@
 #include "layers.hpp"
+#include <cmath>
+#include <map>
+#include <sstream>
+#include "parallel.hpp"
+#include "residency.hpp"
 
 void NeuralNetworkLayer::registerAll() {
-    base_address = ic->getNextAddr();
     for (auto& c : crossbars) ic->registerComponent(&c);
     for (auto& a : accumulators) ic->registerComponent(&a);
     for (auto& a : activations) ic->registerComponent(&a);
 }
 
 NeuralNetworkLayer::NeuralNetworkLayer(uint32_t crossbar_size, Interconnect* ic)
-        : crossbar_size(crossbar_size), ic(ic) {}
+        : crossbar_size(crossbar_size), bit_precision(ic->getConfig().bit_precision), ic(ic) {}
+
+void NeuralNetworkLayer::map_weights(uint32_t row_num, uint32_t vol_num, uint32_t acc_size, const std::string& type, uint32_t groups) {
+    uint32_t vol_num_p_crossbar = crossbar_size / bit_precision;
+    uint32_t group_rows = ceil_div(vol_num, vol_num_p_crossbar);
+    crossbar_row_num = group_rows * groups;
+    crossbar_vol_num = ceil_div(row_num, crossbar_size);
+    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
+    crossbars = ic->getArena().array<CIMCrossbar>(total_num);
+    accumulators = ic->getArena().array<Accumulator>(crossbar_row_num);
+    activations = ic->getArena().array<Activation>(crossbar_row_num);
+
+    // The last crossbar row of a group and the last column hold what is left of the matrix
+    CIMCrossbar* slots = crossbars.reserve_slots(total_num);
+    parallelFor(crossbar_row_num, workersFor(total_num), [&](size_t begin, size_t end, uint32_t) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t volumes = std::min(vol_num_p_crossbar, static_cast<uint32_t>(vol_num - i % group_rows * vol_num_p_crossbar));
+            for (uint32_t j = 0; j < crossbar_vol_num; j++) {
+                uint32_t rows = std::min(crossbar_size, row_num - j * crossbar_size);
+                new (slots + i * crossbar_vol_num + j) CIMCrossbar(crossbar_size, ic, rows, volumes * bit_precision);
+            }
+        }
+    });
+    crossbars.commit_slots(total_num);
+    for (uint32_t i = 0; i < crossbar_row_num; i++) {
+        accumulators.emplace_back(acc_size, ic, bit_precision);
+        activations.emplace_back(crossbar_size, ic, type);
+    }
+}
+
+uint32_t NeuralNetworkLayer::compute_crossbars() {
+    std::vector<uint32_t> crossbar_times(crossbar_row_num, 0);
+    std::vector<uint32_t> acc_times(crossbar_row_num, 0);
+    uint32_t packets = 0;
+    for (auto& c : crossbars) packets = std::max(packets, c.getTimes());
+    ic->startProbe();
+    ic->parallelSends(crossbar_row_num, crossbars.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (uint32_t j = 0; j < crossbar_vol_num; j++) {
+                crossbar_times[i] = std::max(crossbar_times[i], crossbars[i * crossbar_vol_num + j].send(accumulators[i].getAddress()));
+            }
+        }
+    });
+    critical_sends.push_back(ic->takeProbe("Crossbar"));
+    ic->startProbe();
+    ic->parallelSends(crossbar_row_num, crossbars.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            acc_times[i] = accumulators[i].send(activations[i].getAddress());
+        }
+    });
+    critical_sends.push_back(ic->takeProbe("Accumulator"));
+    uint32_t crossbar_max = crossbar_times.empty() ? 0 : *std::max_element(crossbar_times.begin(), crossbar_times.end());
+    uint32_t acc_max = acc_times.empty() ? 0 : *std::max_element(acc_times.begin(), acc_times.end());
+    add_stage(crossbar_max, packets);
+    add_stage(acc_max, packets);
+    return crossbar_max + acc_max;
+}
 
 std::vector<uint32_t> NeuralNetworkLayer::get_input_addr() {
     std::vector<uint32_t> addresses;
     for (uint32_t i = 0; i < crossbar_row_num; i++) {
         for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            addresses.emplace_back(base_address + (i * crossbar_vol_num + j) * UNIT_ADDR);
+            addresses.emplace_back(crossbars[i * crossbar_vol_num + j].getAddress());
         }
     }
     return addresses;
@@ -23,105 +83,144 @@ std::vector<uint32_t> NeuralNetworkLayer::get_input_addr() {
 uint32_t NeuralNetworkLayer::set_up(Component* component, uint32_t data_size) {
     uint32_t left_data = data_size;
     uint32_t delay = 0;
+    // With MULTICAST the crossbars that read the same slice of the input get it in one message
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> slices;
+    uint32_t slice = 0;
     for (auto& addr: get_input_addr()) {
+        uint32_t size = std::min(left_data, crossbar_size);
+        if (MULTICAST) {
+            if (slices.size() <= slice) slices.push_back({size, {}});
+            slices[slice].second.push_back(addr);
+        } else {
+            delay = std::max(delay, component->send(addr, size, ic->getPlanes()));
+        }
         if (left_data > crossbar_size) {
-            delay = component->send(addr, crossbar_size, BIT_PRECISION);
             left_data -= crossbar_size;
+            slice++;
         } else {
-            delay = component->send(addr, left_data, BIT_PRECISION);
             left_data = data_size;
+            slice = 0;
         }
     }
+    for (auto& [size, addresses]: slices) delay = std::max(delay, component->multicast(addresses, size, ic->getPlanes()));
     return delay;
 }
 
 void NeuralNetworkLayer::set_bandwidth() {}
 
-void NeuralNetworkLayer::forward_propagation(std::vector<uint32_t> target_addresses) {}
+void NeuralNetworkLayer::set_sparsity(double zero_fraction) {
+    for (auto& act: activations) act.setSparsity(zero_fraction);
+}
 
-void NeuralNetworkLayer::forward_propagation(uint32_t target_address) {}
+void NeuralNetworkLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    this->input_planes = input_planes;
+    this->output_planes = output_planes;
+    for (auto& act: activations) {
+        act.setInputPlanes(input_planes);
+        act.setPlanes(output_planes);
+    }
+}
 
-uint32_t NeuralNetworkLayer::get_delay() { return times; }
+uint32_t NeuralNetworkLayer::compute() { return 0; }
+
+std::string NeuralNetworkLayer::cache_signature() { return ""; }
+
+uint32_t NeuralNetworkLayer::cached_compute() {
+    stages.clear();
+    windows = 1;
+    critical_sends.clear();
+    // Replays after an edit have to send again, so tracked runs bypass the cache
+    LayerCache* cache = ic->isTracking() ? nullptr : ic->getLayerCache();
+    std::string signature = cache ? cache_signature() : "";
+    if (signature.empty()) return compute();
+
+    // Everything else the internal transfers depend on: the design point and
+    // how many times the previous layer fed each crossbar
+    const SimConfig& config = ic->getConfig();
+    std::ostringstream key;
+    key << signature << (MULTICAST ? "|multicast" : "");
+    // Layers with their own precision, see Model::Conv()
+    auto own = [&](uint32_t planes) { return planes && planes != ic->getPlanes(); };
+    if (bit_precision != config.bit_precision || own(input_planes) || own(output_planes)) {
+        key << "|w" << bit_precision << "i" << input_planes << "o" << output_planes;
+    }
+    key << "|" << config.crossbar_size << "," << config.bit_precision << "," << config.bandwidth
+        << "," << config.class_bandwidth[CB_ACC] << "," << config.class_bandwidth[ACC_ACT] << "," << config.class_bandwidth[IM_CB] << "|";
+    for (size_t i = 0; i < crossbars.size();) {
+        size_t run = i;
+        while (run < crossbars.size() && crossbars[run].getTimes() == crossbars[i].getTimes()) run++;
+        key << crossbars[i].getTimes() << "x" << run - i << ";";
+        i = run;
+    }
 
-FullyConnectedLayer::FullyConnectedLayer(uint32_t input_size, uint32_t neural_num, uint32_t crossbar_size, Interconnect *ic, std::string type)
-    : input_size(input_size), neural_num(neural_num), NeuralNetworkLayer(crossbar_size, ic) {
-        uint32_t vol_num = neural_num;
-        uint32_t row_num = input_size;
-        uint32_t vol_num_p_crossbar = crossbar_size / BIT_PRECISION;
-        crossbar_row_num = ceil_div(vol_num, vol_num_p_crossbar);
-        crossbar_vol_num = ceil_div(row_num, crossbar_size);
-        uint32_t total_num = crossbar_row_num * crossbar_vol_num; 
-
-        uint32_t remain_vol_num = vol_num;
-        for (uint32_t i = 0; i < crossbar_row_num; i++) {
-            uint32_t remain_row_num = row_num;
-            if (remain_vol_num > vol_num_p_crossbar) {
-                for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                    if (remain_row_num > crossbar_size) {
-                        crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, crossbar_size, vol_num_p_crossbar * BIT_PRECISION));
-                        remain_row_num -= crossbar_size;
-                    } else {
-                        crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, remain_row_num, vol_num_p_crossbar * BIT_PRECISION));
-                    }
-                }
-                remain_vol_num -= vol_num_p_crossbar;
-            } else {
-                for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                    if (remain_row_num > crossbar_size) {
-                        crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, crossbar_size, remain_vol_num * BIT_PRECISION));
-                        remain_row_num -= crossbar_size;
-                    } else {
-                        crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, remain_row_num, remain_vol_num * BIT_PRECISION));
-                    }
-                }
-            }
-            accumulators.emplace_back(Accumulator(vol_num_p_crossbar * BIT_PRECISION, ic));
-            activations.emplace_back(Activation(ACT_SIZE, ic, type));
+    // The layer's components have consecutive addresses, a hit in another
+    // simulation reports its sends at the same offsets
+    uint32_t base = crossbars.empty() ? 0 : crossbars[0].getAddress();
+    if (const LayerResult* hit = cache->find(key.str())) {
+        for (auto& c : crossbars) c.clearInput();
+        for (size_t i = 0; i < activations.size(); i++) {
+            activations[i].load(hit->activations[i].first, hit->activations[i].second);
         }
-        registerAll();
-        set_bandwidth();
+        ic->addTotals(hit->traffic);
+        stages = hit->stages;
+        windows = hit->windows;
+        critical_sends = hit->critical_sends;
+        for (auto& send: critical_sends) {
+            send.source += base;
+            send.destination += base;
+        }
+        return hit->delay;
     }
 
-void FullyConnectedLayer::set_bandwidth() {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
-
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            ic->setBandWidth(crossbars[i*crossbar_vol_num+j].getAddress(), base_address + (total_num + i) * UNIT_ADDR, CB_ACC_BW);
-        }
-        ic->setBandWidth(accumulators[i].getAddress(), base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR, ACC_ACT_BW);
+    LayerResult result;
+    TrafficTotals before = ic->takeTotals();
+    result.delay = compute();
+    result.traffic = ic->takeTotals();
+    ic->addTotals(before);
+    ic->addTotals(result.traffic);
+    for (auto& act : activations) result.activations.emplace_back(act.getBits(), act.getTimes());
+    result.stages = stages;
+    result.windows = windows;
+    result.critical_sends = critical_sends;
+    for (auto& send: result.critical_sends) {
+        send.source -= base;
+        send.destination -= base;
     }
+    cache->insert(key.str(), result);
+    return result.delay;
 }
 
-void FullyConnectedLayer::forward_propagation(std::vector<uint32_t> target_addresses) {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
-
-    uint32_t crossbar_times = 0;
-    uint32_t acc_times = 0;
-    uint32_t act_times = 0;
-
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            uint32_t cb_t = crossbars[i*crossbar_vol_num+j].send(base_address + (total_num + i) * UNIT_ADDR);
-            if (crossbar_times < cb_t) {
-                crossbar_times = cb_t;
-            }
+void NeuralNetworkLayer::connect_outputs(std::vector<uint32_t> target_addresses) {
+    uint32_t i = 0;
+    uint32_t act_amount = activations.size();
+    uint32_t addr_amount = target_addresses.size();
+    if (act_amount <= addr_amount) {
+        for (auto &addr: target_addresses) {
+            ic->setBandWidth(activations[i%act_amount].getAddress(), addr, LAYER);
+            i++;
         }
-        uint32_t acc_t = accumulators[i].send(base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR);
-        if (acc_times < acc_t) {
-            acc_times = acc_t;
+    } else {
+        for(auto &act: activations) {
+            ic->setBandWidth(act.getAddress(), target_addresses[i%addr_amount], LAYER);
+            i++;
         }
     }
+}
+
+uint32_t NeuralNetworkLayer::send_outputs(std::vector<uint32_t> target_addresses) {
+    uint32_t act_times = 0;
 
     uint32_t i = 0;
     uint32_t act_amount = activations.size();
     uint32_t addr_amount = target_addresses.size();
-    if (act_amount <= addr_amount) {
-        for (auto &addr: target_addresses) {
-            ic->setBandWidth(activations[i%act_amount].getAddress(), addr, LAYER_BW);
-            i++;
+    if (MULTICAST && act_amount < addr_amount) {
+        // Every activation unit sends the same output to each of its targets
+        std::vector<std::vector<uint32_t>> fanouts(act_amount);
+        for (auto &addr: target_addresses) fanouts[i++ % act_amount].push_back(addr);
+        for (uint32_t a = 0; a < act_amount; a++) {
+            act_times = std::max(act_times, activations[a].multicast(fanouts[a], activations[a].getBits(), activations[a].getOutputTimes()));
         }
-        i = 0;
+    } else if (act_amount <= addr_amount) {
         for (auto &addr: target_addresses) {
             uint32_t act_t = activations[i%act_amount].send(addr);
             if (act_times < act_t) {
@@ -130,11 +229,6 @@ void FullyConnectedLayer::forward_propagation(std::vector<uint32_t> target_addre
             i++;
         }
     } else {
-        for(auto &act: activations) {
-            ic->setBandWidth(act.getAddress(), target_addresses[i%addr_amount], LAYER_BW);
-            i++;
-        }
-        i = 0;
         for(auto &act: activations) {
             uint32_t act_t = act.send(target_addresses[i%addr_amount]);
             if (act_times < act_t) {
@@ -143,47 +237,203 @@ void FullyConnectedLayer::forward_propagation(std::vector<uint32_t> target_addre
             i++;
         }
     }
-    this->times += (crossbar_times + acc_times + act_times);
+    return act_times;
 }
 
-void FullyConnectedLayer::forward_propagation(uint32_t target_address) {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
+void NeuralNetworkLayer::forward_propagation(std::vector<std::vector<uint32_t>> target_groups) {
+    uint32_t compute_times = cached_compute();
+
+    // Each consumer receives the whole output, links are set up first so they share the ports
+    for (auto &targets: target_groups) {
+        connect_outputs(targets);
+    }
+    uint32_t output_times = 0;
+    ic->startProbe();
+    for (auto &targets: target_groups) {
+        output_times = std::max(output_times, send_outputs(targets));
+    }
+    critical_sends.push_back(ic->takeProbe("Output"));
+    this->times += stage_delay(compute_times, output_times);
+}
 
-    uint32_t crossbar_times = 0;
-    uint32_t acc_times = 0;
+void NeuralNetworkLayer::forward_propagation(std::vector<uint32_t> target_addresses) {
+    forward_propagation(std::vector<std::vector<uint32_t>>{target_addresses});
+}
+
+// Sink layer, every activation unit sends to the target
+void NeuralNetworkLayer::forward_propagation(uint32_t target_address) {
+    uint32_t compute_times = cached_compute();
     uint32_t act_times = 0;
+    ic->startProbe();
+    for (auto& act : activations) {
+        uint32_t act_t = act.send(target_address);
+        if (act_times < act_t) {
+            act_times = act_t;
+        }
+    }
+    critical_sends.push_back(ic->takeProbe("Output"));
+    this->times += stage_delay(compute_times, act_times);
+}
 
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            uint32_t cb_t = crossbars[i*crossbar_vol_num+j].send(base_address + (total_num + i) * UNIT_ADDR);
-            if (crossbar_times < cb_t) {
-                crossbar_times = cb_t;
-            }
+void NeuralNetworkLayer::add_stage(uint32_t delay, uint32_t packets, bool whole_windows, std::vector<uint32_t> weights) {
+    stages.push_back({delay, std::max(packets / windows, 1u), whole_windows, std::move(weights)});
+}
+
+namespace {
+
+// Time of every packet group of a stage. Windows get the delay in proportion
+// to their weight and a window's packets share it evenly; integer splits at
+// the cumulative boundaries leave the remainders with the later groups.
+std::vector<uint32_t> groupTimes(const PipelineStage& stage, uint32_t windows) {
+    std::vector<uint64_t> bounds(windows + 1, 0);
+    for (uint32_t w = 0; w < windows; w++) {
+        bounds[w + 1] = bounds[w] + (stage.weights.size() == windows ? stage.weights[w] : 1);
+    }
+    uint64_t total = std::max<uint64_t>(bounds.back(), 1);
+    std::vector<uint32_t> times;
+    times.reserve(static_cast<size_t>(windows) * stage.packets);
+    for (uint32_t w = 0; w < windows; w++) {
+        uint64_t window = stage.delay * bounds[w + 1] / total - stage.delay * bounds[w] / total;
+        for (uint32_t j = 0; j < stage.packets; j++) {
+            times.push_back(static_cast<uint32_t>(window * (j + 1) / stage.packets - window * j / stage.packets));
         }
-        uint32_t acc_t = accumulators[i].send(base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR);
-        uint32_t act_t = activations[i].send(target_address);
-        if (acc_times < acc_t) {
-            acc_times = acc_t;
+    }
+    return times;
+}
+
+// Stage s starts a group once it finished its previous one, the stage before
+// finished the group and the stage after started the group depth before,
+// freeing a slot of the buffer between them. A stage that splits a window
+// differently from the one before, or needs all of its planes, takes whole
+// windows and its buffer holds depth windows.
+uint32_t pipelineDelay(const std::vector<PipelineStage>& stages, uint32_t windows, uint32_t depth) {
+    size_t stage_num = stages.size();
+    std::vector<bool> by_packet(stage_num, false);
+    std::vector<std::vector<uint32_t>> times(stage_num);
+    std::vector<std::vector<uint64_t>> start(stage_num), finish(stage_num);
+    for (size_t s = 0; s < stage_num; s++) {
+        by_packet[s] = s > 0 && !stages[s].whole_windows && stages[s].packets == stages[s - 1].packets;
+        times[s] = groupTimes(stages[s], windows);
+        start[s].resize(times[s].size());
+        finish[s].resize(times[s].size());
+    }
+    for (uint32_t w = 0; w < windows; w++) {
+        // Stages taking packet by packet go through a window together
+        for (size_t first = 0, last = 1; first < stage_num; first = last++) {
+            while (last < stage_num && by_packet[last]) last++;
+            for (uint32_t j = 0; j < stages[first].packets; j++) {
+                for (size_t s = first; s < last; s++) {
+                    size_t group = static_cast<size_t>(w) * stages[s].packets + j;
+                    uint64_t begin = group ? finish[s][group - 1] : 0;
+                    if (s > first) {
+                        begin = std::max(begin, finish[s - 1][group]);
+                    } else if (s > 0) {
+                        begin = std::max(begin, finish[s - 1][static_cast<size_t>(w + 1) * stages[s - 1].packets - 1]);
+                    }
+                    if (s + 1 < stage_num && by_packet[s + 1] && group >= depth) {
+                        begin = std::max(begin, start[s + 1][group - depth]);
+                    } else if (s + 1 < stage_num && !by_packet[s + 1] && w >= depth) {
+                        begin = std::max(begin, start[s + 1][static_cast<size_t>(w - depth) * stages[s + 1].packets]);
+                    }
+                    start[s][group] = begin;
+                    finish[s][group] = begin + times[s][group];
+                }
+            }
         }
-        if (act_times < act_t) {
-            act_times = act_t;
+    }
+    return static_cast<uint32_t>(finish.back().back());
+}
+
+}
+
+uint32_t NeuralNetworkLayer::stage_delay(uint32_t compute_times, uint32_t output_times) {
+    uint32_t serial = compute_times + output_times;
+    if (PIPELINE_DEPTH == 0 || stages.size() <= serial_stages) return serial;
+    // The activations send a window once they have all of its planes
+    uint32_t packets = 0;
+    for (auto& act : activations) packets = std::max(packets, act.getOutputTimes());
+    std::vector<PipelineStage> overlapped(stages.begin() + serial_stages, stages.end());
+    overlapped.push_back({output_times, std::max(packets / windows, 1u), true, {}});
+
+    uint32_t pipelined = std::min(serial, get_write_delay() + pipelineDelay(overlapped, windows, PIPELINE_DEPTH));
+    overlap_saved += serial - pipelined;
+    return pipelined;
+}
+
+uint32_t NeuralNetworkLayer::get_delay() { return times; }
+
+uint32_t NeuralNetworkLayer::get_overlap_saved() { return overlap_saved; }
+
+uint32_t NeuralNetworkLayer::get_write_delay() {
+    uint32_t delay = 0;
+    for (size_t s = 0; s < serial_stages && s < stages.size(); s++) delay += stages[s].delay;
+    return delay;
+}
+
+const std::vector<CriticalSend>& NeuralNetworkLayer::get_critical_sends() { return critical_sends; }
+
+void NeuralNetworkLayer::save_state() {
+    saved_times.clear();
+    for (auto& c : crossbars) saved_times.push_back(c.getTimes());
+}
+
+void NeuralNetworkLayer::restore_state() {
+    for (size_t i = 0; i < saved_times.size(); i++) crossbars[i].load(saved_times[i]);
+    times = 0;
+    overlap_saved = 0;
+}
+
+uint32_t NeuralNetworkLayer::get_crossbar_num() { return crossbars.size(); }
+
+uint64_t NeuralNetworkLayer::get_weight_bits() {
+    uint64_t bits = 0;
+    for (auto& c : crossbars) bits += c.getValidArea();
+    return bits;
+}
+
+uint32_t NeuralNetworkLayer::get_program_rows() {
+    uint32_t rows = 0;
+    for (auto& c : crossbars) rows = std::max(rows, c.getValidRows());
+    return rows;
+}
+
+FullyConnectedLayer::FullyConnectedLayer(uint32_t input_size, uint32_t neural_num, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits)
+    : input_size(input_size), neural_num(neural_num), NeuralNetworkLayer(crossbar_size, ic) {
+        if (weight_bits) bit_precision = weight_bits;
+        uint32_t vol_num_p_crossbar = crossbar_size / bit_precision;
+        map_weights(input_size, neural_num, vol_num_p_crossbar * bit_precision, type);
+        registerAll();
+        set_bandwidth();
+    }
+
+void FullyConnectedLayer::set_bandwidth() {
+    for (uint32_t i = 0; i < crossbar_row_num; i++) {
+        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
+            ic->setBandWidth(crossbars[i*crossbar_vol_num+j].getAddress(), accumulators[i].getAddress(), CB_ACC);
         }
+        ic->setBandWidth(accumulators[i].getAddress(), activations[i].getAddress(), ACC_ACT);
     }
-    this->times += (crossbar_times + acc_times + act_times);
 }
 
-ConvolutionLayer::ConvolutionLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t stride, uint32_t pad, uint32_t crossbar_size, Interconnect *ic, std::string type)
+std::string FullyConnectedLayer::cache_signature() {
+    return "FC:" + std::to_string(input_size) + "," + std::to_string(neural_num);
+}
+
+uint32_t FullyConnectedLayer::compute() {
+    return compute_crossbars();
+}
+
+ConvolutionLayer::ConvolutionLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t stride, uint32_t pad, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits)
 : NeuralNetworkLayer(crossbar_size, ic) , stride(stride), pad(pad), _im2col(crossbar_size, ic, kernel_size, input_size, stride, pad) {
+    if (weight_bits) bit_precision = weight_bits;
     std::copy(input_size, input_size + 3, this->input_size);
     std::copy(kernel_size, kernel_size + 3, this->kernel_size);
     uint32_t img_row_num = input_size[0]-kernel_size[0]+1 + pad * 2;
     uint32_t img_vol_num = input_size[1]-kernel_size[1]+1 + pad * 2;
     if (img_row_num < 1 || img_vol_num < 1) {
-        std::cout << "Illegal kernel size!" << std::endl;
-        exit(1);
+        fail("Illegal kernel size!");
     }
 
-    uint32_t vol_num_p_crossbar = crossbar_size / BIT_PRECISION;
     uint32_t row_num = 0;
     uint32_t vol_num = 0;
     if (mapping_flag) {
@@ -194,38 +444,12 @@ ConvolutionLayer::ConvolutionLayer(uint32_t input_size[3], uint32_t kernel_size[
         vol_num = kernel_size[2];
     }
 
-    crossbar_row_num = ceil_div(vol_num, vol_num_p_crossbar); 
-    crossbar_vol_num = ceil_div(row_num, crossbar_size);
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
-
-    uint32_t remain_vol_num = vol_num;
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        uint32_t remain_row_num = row_num;
-        if (remain_vol_num > vol_num_p_crossbar) {
-            for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                if (remain_row_num > crossbar_size) {
-                    crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, crossbar_size, vol_num_p_crossbar * BIT_PRECISION));
-                    remain_row_num -= crossbar_size;
-                } else {
-                    crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, remain_row_num, vol_num_p_crossbar * BIT_PRECISION));
-                }
-            }
-            remain_vol_num -= vol_num_p_crossbar;
-        } else {
-            for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                if (remain_row_num > crossbar_size) {
-                    crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, crossbar_size, remain_vol_num * BIT_PRECISION));
-                    remain_row_num -= crossbar_size;
-                } else {
-                    crossbars.emplace_back(CIMCrossbar(crossbar_size, ic, remain_row_num, remain_vol_num * BIT_PRECISION));
-                }
-            }
-        }
-        accumulators.emplace_back(Accumulator(ACC_SIZE, ic));
-        activations.emplace_back(Activation(ACT_SIZE, ic, type));
-    }
+    map_weights(row_num, vol_num, crossbar_size, type);
     registerAll();
-    if (!mapping_flag) { ic->registerComponent(&_im2col); }
+    if (!mapping_flag) {
+        ic->registerComponent(&_im2col);
+        _im2col.setLineBuffer(line_buffer);
+    }
     set_bandwidth();
 }
 
@@ -233,7 +457,7 @@ std::vector<uint32_t> ConvolutionLayer::get_input_addr() {
     if (mapping_flag) {
         return NeuralNetworkLayer::get_input_addr();
     } else {
-        return {base_address + crossbar_row_num * (crossbar_vol_num + 2) * UNIT_ADDR};
+        return {_im2col.getAddress()};
     }
 }
 
@@ -246,91 +470,36 @@ uint32_t ConvolutionLayer::set_up(Component* component, uint32_t data_size) {
 }
 
 void ConvolutionLayer::set_bandwidth() {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
-    
     if (!mapping_flag) {
         for (uint32_t i = 0; i < crossbar_row_num; i++) {
             for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                ic->setBandWidth(_im2col.getAddress(), crossbars[i*crossbar_vol_num+j].getAddress(), IM_CB_BW);
+                ic->setBandWidth(_im2col.getAddress(), crossbars[i*crossbar_vol_num+j].getAddress(), IM_CB);
             }
         }
     }
     for (uint32_t i = 0; i < crossbar_row_num; i++) {
         for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            ic->setBandWidth(crossbars[i*crossbar_vol_num+j].getAddress(), base_address + (total_num + i) * UNIT_ADDR, CB_ACC_BW);
+            ic->setBandWidth(crossbars[i*crossbar_vol_num+j].getAddress(), accumulators[i].getAddress(), CB_ACC);
         }
-        ic->setBandWidth(accumulators[i].getAddress(), base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR, ACC_ACT_BW);
+        ic->setBandWidth(accumulators[i].getAddress(), activations[i].getAddress(), ACC_ACT);
     }
 }
 
-void ConvolutionLayer::forward_propagation(std::vector<uint32_t> target_addresses) {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
-
-    uint32_t crossbar_times = 0;
-    uint32_t acc_times = 0;
-    uint32_t act_times = 0;
-    
-    if (!mapping_flag) {
-        std::vector<uint32_t> crossbar_addrs;
-        for (uint32_t i = 0; i < crossbar_row_num; i++) {
-            for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-                crossbar_addrs.emplace_back(crossbars[i*crossbar_vol_num+j].getAddress());
-            }
-        }
-        this->times += _im2col.send(crossbar_addrs);
-    }
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            uint32_t cb_t = crossbars[i*crossbar_vol_num+j].send(base_address + (total_num + i) * UNIT_ADDR);
-            if (crossbar_times < cb_t) {
-                crossbar_times = cb_t;
-            }
-        }
-        uint32_t acc_t = accumulators[i].send(base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR);
-        if (acc_times < acc_t) {
-            acc_times = acc_t;
-        }
-    }
-
-    uint32_t i = 0;
-    uint32_t act_amount = activations.size();
-    uint32_t addr_amount = target_addresses.size();
-    if (act_amount <= addr_amount) {
-        for (auto &addr: target_addresses) {
-            ic->setBandWidth(activations[i%act_amount].getAddress(), addr, LAYER_BW);
-            i++;
-        }
-        i = 0;
-        for (auto &addr: target_addresses) {
-            uint32_t act_t = activations[i%act_amount].send(addr);
-            if (act_times < act_t) {
-                act_times = act_t;
-            }
-            i++;
-        }
-    } else {
-        for(auto &act: activations) {
-            ic->setBandWidth(act.getAddress(), target_addresses[i%addr_amount], LAYER_BW);
-            i++;
-        }
-        i = 0;
-        for(auto &act: activations) {
-            uint32_t act_t = act.send(target_addresses[i%addr_amount]);
-            if (act_times < act_t) {
-                act_times = act_t;
-            }
-            i++;
-        }
-    }
-    this->times += (crossbar_times + acc_times + act_times);
+void ConvolutionLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    NeuralNetworkLayer::set_planes(input_planes, output_planes);
+    _im2col.setPlanes(input_planes);
 }
 
-void ConvolutionLayer::forward_propagation(uint32_t target_address) {
-    uint32_t total_num = crossbar_row_num * crossbar_vol_num;
+std::string ConvolutionLayer::cache_signature() {
+    std::ostringstream signature;
+    signature << "Conv:" << input_size[0] << "," << input_size[1] << "," << input_size[2] << ":"
+              << kernel_size[0] << "," << kernel_size[1] << "," << kernel_size[2] << ":"
+              << stride << "," << pad << ":" << mapping_flag << line_buffer;
+    return signature.str();
+}
 
-    uint32_t crossbar_times = 0;
-    uint32_t acc_times = 0;
-    uint32_t act_times = 0;
+uint32_t ConvolutionLayer::compute() {
+    uint32_t im2col_times = 0;
 
     if (!mapping_flag) {
         std::vector<uint32_t> crossbar_addrs;
@@ -339,26 +508,13 @@ void ConvolutionLayer::forward_propagation(uint32_t target_address) {
                 crossbar_addrs.emplace_back(crossbars[i*crossbar_vol_num+j].getAddress());
             }
         }
-        this->times += _im2col.send(crossbar_addrs);
+        ic->startProbe();
+        im2col_times = _im2col.send(crossbar_addrs);
+        windows = std::max(_im2col.getWindows(), 1u);
+        add_stage(im2col_times, windows * _im2col.getPlanes(), false, _im2col.getWindowPixels());
+        critical_sends.push_back(ic->takeProbe("Im2col"));
     }
-    for (uint32_t i = 0; i < crossbar_row_num; i++) {
-        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
-            uint32_t cb_t = crossbars[i*crossbar_vol_num+j].send(base_address + (total_num + i) * UNIT_ADDR);
-            if (crossbar_times < cb_t) {
-                crossbar_times = cb_t;
-            }
-        }
-        uint32_t acc_t = accumulators[i].send(base_address + (total_num + crossbar_row_num + i) * UNIT_ADDR);
-        uint32_t act_t = activations[i].send(target_address);
-        
-        if (acc_times < acc_t) {
-            acc_times = acc_t;
-        }
-        if (act_times < act_t) {
-            act_times = act_t;
-        }
-    }
-    this->times += (crossbar_times + acc_times + act_times);
+    return im2col_times + compute_crossbars();
 }
 
 PoolingLayer::PoolingLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t crossbar_size, Interconnect *ic, std::string type)
@@ -372,22 +528,45 @@ std::vector<uint32_t> PoolingLayer::get_input_addr() {
     return std::vector<uint32_t>(1, _pool.getAddress());
 }
 
-void PoolingLayer::forward_propagation(std::vector<uint32_t> target_addresses) {
+void PoolingLayer::set_sparsity(double zero_fraction) { _pool.setSparsity(zero_fraction); }
+void PoolingLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    NeuralNetworkLayer::set_planes(input_planes, output_planes);
+    _pool.setPlanes(input_planes);
+}
+
+uint32_t PoolingLayer::compute() {
     _pool.pooling(input_size, kernel_size);
+    return 0;
+}
+
+void PoolingLayer::connect_outputs(std::vector<uint32_t> target_addresses) {
+    for (auto &addr: target_addresses) {
+        ic->setBandWidth(_pool.getAddress(), addr, LAYER);
+    }
+}
+
+uint32_t PoolingLayer::send_outputs(std::vector<uint32_t> target_addresses) {
     if (target_addresses.size() > 1) {
-        for (auto &addr: target_addresses) {
-            ic->setBandWidth(_pool.getAddress(), addr, LAYER_BW);
-        }
-        this->times += _pool.send(target_addresses);
+        return _pool.send(target_addresses);
     } else {
-        ic->setBandWidth(_pool.getAddress(), target_addresses[0], LAYER_BW);
-        this->times += _pool.send(target_addresses[0]);
+        return _pool.send(target_addresses[0]);
     }
 }
 
+// Pooling replaces the received input with its output
+void PoolingLayer::save_state() { saved_pool.reset(new Pool(_pool)); }
+
+void PoolingLayer::restore_state() {
+    _pool.restoreInput(*saved_pool);
+    times = 0;
+}
+
 void PoolingLayer::forward_propagation(uint32_t target_address) {
     _pool.pooling(input_size, kernel_size);
+    critical_sends.clear();
+    ic->startProbe();
     this->times += _pool.send(target_address);
+    critical_sends.push_back(ic->takeProbe("Output"));
 }
 
 FlattenLayer::FlattenLayer(uint32_t crossbar_size, Interconnect *ic)
@@ -399,9 +578,178 @@ std::vector<uint32_t> FlattenLayer::get_input_addr() {
     return std::vector<uint32_t>(1, _flatten.getAddress());
 }
 
-void FlattenLayer::forward_propagation(std::vector<uint32_t> target_addresses) {
+void FlattenLayer::set_sparsity(double zero_fraction) { _flatten.setSparsity(zero_fraction); }
+void FlattenLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    NeuralNetworkLayer::set_planes(input_planes, output_planes);
+    _flatten.setPlanes(input_planes);
+}
+
+void FlattenLayer::connect_outputs(std::vector<uint32_t> target_addresses) {
     for (auto &addr: target_addresses) {
-        ic->setBandWidth(_flatten.getAddress(), addr, LAYER_BW);
+        ic->setBandWidth(_flatten.getAddress(), addr, LAYER);
     }
-    this->times += _flatten.send(target_addresses);
-}
\ No newline at end of file
+}
+
+uint32_t FlattenLayer::send_outputs(std::vector<uint32_t> target_addresses) {
+    return _flatten.send(target_addresses);
+}
+
+MergeLayer::MergeLayer(uint32_t input_num, uint32_t crossbar_size, Interconnect *ic, std::string type)
+: NeuralNetworkLayer(crossbar_size, ic), _merge(crossbar_size, ic, type, input_num) {
+    ic->registerComponent(&_merge);
+}
+
+std::vector<uint32_t> MergeLayer::get_input_addr() {
+    return std::vector<uint32_t>(1, _merge.getAddress());
+}
+
+void MergeLayer::set_sparsity(double zero_fraction) { _merge.setSparsity(zero_fraction); }
+void MergeLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    NeuralNetworkLayer::set_planes(input_planes, output_planes);
+    _merge.setPlanes(input_planes);
+}
+
+void MergeLayer::connect_outputs(std::vector<uint32_t> target_addresses) {
+    for (auto &addr: target_addresses) {
+        ic->setBandWidth(_merge.getAddress(), addr, LAYER);
+    }
+}
+
+uint32_t MergeLayer::send_outputs(std::vector<uint32_t> target_addresses) {
+    if (target_addresses.size() > 1) {
+        return _merge.send(target_addresses);
+    } else {
+        return _merge.send(target_addresses[0]);
+    }
+}
+
+void MergeLayer::forward_propagation(uint32_t target_address) {
+    critical_sends.clear();
+    ic->startProbe();
+    this->times += _merge.send(target_address);
+    critical_sends.push_back(ic->takeProbe("Output"));
+}
+
+MatMulLayer::MatMulLayer(uint32_t tokens, uint32_t depth, uint32_t columns, uint32_t heads, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits)
+: NeuralNetworkLayer(crossbar_size, ic), tokens(tokens), depth(depth), columns(columns), heads(heads), softmax(type == "softmax"),
+  _operands(crossbar_size, ic) {
+    if (WRITE_BW == 0) {
+        fail("Write bandwidth must be positive!");
+    }
+    bit_precision = weight_bits;
+    serial_stages = 1;
+    uint32_t vol_num_p_crossbar = crossbar_size / bit_precision;
+    map_weights(depth, columns, vol_num_p_crossbar * bit_precision, type, heads);
+    registerAll();
+    ic->registerComponent(&_operands);
+    // A head on a single activation unit normalizes its rows in place
+    if (softmax && crossbar_row_num > heads) {
+        reducers = ic->getArena().array<Softmax>(heads);
+        for (uint32_t h = 0; h < heads; h++) ic->registerComponent(&reducers.emplace_back(crossbar_size, ic));
+    }
+    set_bandwidth();
+}
+
+std::vector<uint32_t> MatMulLayer::get_input_addr() {
+    return std::vector<uint32_t>(1, _operands.getAddress());
+}
+
+uint32_t MatMulLayer::set_up(Component* component, uint32_t data_size) {
+    return component->send(_operands.getAddress(), data_size, ic->getPlanes());
+}
+
+void MatMulLayer::set_bandwidth() {
+    uint32_t group_rows = crossbar_row_num / heads;
+    for (uint32_t i = 0; i < crossbar_row_num; i++) {
+        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
+            ic->setBandWidth(_operands.getAddress(), crossbars[i*crossbar_vol_num+j].getAddress(), IM_CB);
+            ic->setBandWidth(crossbars[i*crossbar_vol_num+j].getAddress(), accumulators[i].getAddress(), CB_ACC);
+        }
+        ic->setBandWidth(accumulators[i].getAddress(), activations[i].getAddress(), ACC_ACT);
+        if (!reducers.empty()) {
+            ic->setBandWidth(activations[i].getAddress(), reducers[i / group_rows].getAddress(), ACC_ACT);
+            ic->setBandWidth(reducers[i / group_rows].getAddress(), activations[i].getAddress(), ACC_ACT);
+        }
+    }
+}
+
+void MatMulLayer::set_planes(uint32_t input_planes, uint32_t output_planes) {
+    NeuralNetworkLayer::set_planes(input_planes, output_planes);
+    _operands.setPlanes(input_planes);
+}
+
+std::string MatMulLayer::cache_signature() {
+    std::ostringstream signature;
+    signature << "MatMul:" << tokens << "," << depth << "," << columns << ":" << heads << "," << softmax;
+    return signature.str();
+}
+
+uint32_t MatMulLayer::write_weights() {
+    // One tile row per packet, the crossbar keeps it as weights rather than input
+    ic->startProbe();
+    uint32_t transfer = 0;
+    for (auto& c : crossbars) {
+        transfer = std::max(transfer, _operands.send(c.getAddress(), c.getValidArea() / c.getValidRows(), c.getValidRows()));
+        c.clearInput();
+    }
+    critical_sends.push_back(ic->takeProbe("Write"));
+    uint32_t program = programDelay(get_weight_bits(), get_program_rows(), WRITE_BW, ROW_PROGRAM_LATENCY) * UNIT_TIME;
+    add_stage(transfer + program, 1);
+    return transfer + program;
+}
+
+uint32_t MatMulLayer::reduce_softmax() {
+    if (reducers.empty()) return 0;
+    uint32_t group_rows = crossbar_row_num / heads;
+    uint32_t partial = 0, normalize = 0;
+    ic->startProbe();
+    for (uint32_t i = 0; i < crossbar_row_num; i++) {
+        partial = std::max(partial, activations[i].send(reducers[i / group_rows].getAddress(), 2, activations[i].getOutputTimes()));
+    }
+    for (uint32_t h = 0; h < heads; h++) {
+        // The normalizer scales the values the units hold rather than replacing them
+        std::vector<uint32_t> units;
+        std::vector<std::pair<uint32_t, uint32_t>> held;
+        for (uint32_t i = h * group_rows; i < (h + 1) * group_rows; i++) {
+            units.push_back(activations[i].getAddress());
+            held.push_back({activations[i].getBits(), activations[i].getTimes()});
+        }
+        normalize = std::max(normalize, reducers[h].multicast(units, 1, activations[h * group_rows].getOutputTimes()));
+        for (uint32_t k = 0; k < group_rows; k++) activations[h * group_rows + k].load(held[k].first, held[k].second);
+    }
+    critical_sends.push_back(ic->takeProbe("Softmax"));
+    uint32_t packets = 0;
+    for (auto& act : activations) packets = std::max(packets, act.getOutputTimes());
+    add_stage(partial + normalize, packets, true);
+    return partial + normalize;
+}
+
+uint32_t MatMulLayer::compute() {
+    windows = std::max(tokens, 1u);
+    uint32_t write_times = write_weights();
+
+    // Every crossbar row of a head reads the same slices of its tokens
+    uint32_t group_rows = crossbar_row_num / heads;
+    uint32_t token_times = tokens * _operands.getPlanes();
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> slices;
+    uint32_t input_times = 0;
+    ic->startProbe();
+    for (uint32_t i = 0; i < crossbar_row_num; i++) {
+        for (uint32_t j = 0; j < crossbar_vol_num; j++) {
+            uint32_t addr = crossbars[i*crossbar_vol_num+j].getAddress();
+            if (MULTICAST) {
+                slices[{i / group_rows, j}].push_back(addr);
+            } else {
+                input_times = std::max(input_times, _operands.send(addr, std::min(crossbar_size, depth - j * crossbar_size), token_times));
+            }
+        }
+    }
+    for (auto& [slice, addresses]: slices) {
+        input_times = std::max(input_times, _operands.multicast(addresses, std::min(crossbar_size, depth - slice.second * crossbar_size), token_times));
+    }
+    add_stage(input_times, token_times);
+    critical_sends.push_back(ic->takeProbe("Input"));
+
+    uint32_t crossbar_times = compute_crossbars();
+    return write_times + input_times + crossbar_times + reduce_softmax();
+}
@@ -1,19 +1,65 @@
 #pragma once
 #include <chrono>
 #include "components.hpp"
+#include "layer_cache.hpp"
 
 class NeuralNetworkLayer {
     protected:
-    std::vector<CIMCrossbar> crossbars;
-    std::vector<Accumulator> accumulators;
-    std::vector<Activation> activations;
-    uint32_t base_address, crossbar_vol_num, crossbar_row_num, crossbar_size;
+    ArenaArray<CIMCrossbar> crossbars;
+    ArenaArray<Accumulator> accumulators;
+    ArenaArray<Activation> activations;
+    uint32_t crossbar_vol_num, crossbar_row_num, crossbar_size;
+    uint32_t bit_precision;     // weight precision, crossbar columns per weight
+    uint32_t input_planes = 0, output_planes = 0;   // set_planes(), 0 for those of the interconnect
     Interconnect* ic;
 
     uint32_t times = 0;
+    std::vector<uint32_t> saved_times;
+
+    // Stages compute() ran, the output sends follow them
+    std::vector<PipelineStage> stages;
+    // Windows every stage splits its packets over, 1 without im2col
+    uint32_t windows = 1;
+    // Leading stages that finish before the others start, e.g. writing dynamic weights
+    uint32_t serial_stages = 0;
+    uint32_t overlap_saved = 0;
+    // Slowest send of every stage, the outputs last. A layer cache hit
+    // replays the delays only, its compute stages are missing here.
+    std::vector<CriticalSend> critical_sends;
+
+    // Records a stage compute() ran, packets is the total every unit of it sent
+    void add_stage(uint32_t delay, uint32_t packets, bool whole_windows = false, std::vector<uint32_t> weights = {});
+
+    // compute_times + output_times, or the overlapped stages with PIPELINE_DEPTH
+    uint32_t stage_delay(uint32_t compute_times, uint32_t output_times);
 
     void registerAll();
 
+    // Spreads a row_num x vol_num weight matrix over crossbars, one accumulator
+    // and activation per crossbar row. groups places that many independent
+    // matrices side by side, each on its own crossbar rows. Large layers build
+    // their crossbars on all workers, registerAll() assigns the addresses afterwards.
+    void map_weights(uint32_t row_num, uint32_t vol_num, uint32_t acc_size, const std::string& type, uint32_t groups = 1);
+
+    // Every crossbar sends to its accumulator and every accumulator to its
+    // activation. Crossbar rows are independent, large layers split them
+    // across the workers; returns the slowest crossbar plus the slowest accumulator.
+    uint32_t compute_crossbars();
+
+    // Work done inside the layer before its outputs leave, returns the delay
+    virtual uint32_t compute();
+
+    // compute(), or its replay from the layer cache when the interconnect has one
+    uint32_t cached_compute();
+
+    // Kind and shapes that determine compute(), empty if the layer is not cached
+    virtual std::string cache_signature();
+
+    // Links and sends the layer outputs to one consumer
+    virtual void connect_outputs(std::vector<uint32_t> target_addresses);
+
+    virtual uint32_t send_outputs(std::vector<uint32_t> target_addresses);
+
 public:
     NeuralNetworkLayer(uint32_t crossbar_size, Interconnect* ic);
 
@@ -23,25 +69,54 @@ public:
 
     virtual void set_bandwidth();
 
-    virtual void forward_propagation(std::vector<uint32_t> target_addresses);
+    // Fraction of zeros in the layer output, used to compress the outgoing transfers
+    virtual void set_sparsity(double zero_fraction);
+
+    // Bit planes of the activations the layer reads and of those it writes
+    virtual void set_planes(uint32_t input_planes, uint32_t output_planes);
+
+    // One address list per consumer, every consumer receives the whole output
+    void forward_propagation(std::vector<std::vector<uint32_t>> target_groups);
+
+    void forward_propagation(std::vector<uint32_t> target_addresses);
 
     virtual void forward_propagation(uint32_t target_address);
 
     uint32_t get_delay();
+    // Delay the overlapped stages saved over running them one after another
+    uint32_t get_overlap_saved();
+    // Delay of the serial stages, rewriting the weights of a MatMulLayer
+    uint32_t get_write_delay();
+    const std::vector<CriticalSend>& get_critical_sends();
+
+    // Input the layer consumes when it runs, kept to simulate it again after
+    // an edit; restoring also clears the delay
+    virtual void save_state();
+    virtual void restore_state();
+
+    // Weight footprint, used when layers time-share a crossbar pool
+    uint32_t get_crossbar_num();
+    uint64_t get_weight_bits();
+    uint32_t get_program_rows();
+
+    virtual ~NeuralNetworkLayer() {}
 };
 
 class FullyConnectedLayer: public NeuralNetworkLayer {
     private:
     uint32_t input_size;
     uint32_t neural_num;
+
+    uint32_t compute() override;
+    std::string cache_signature() override;
+
     public:
-    FullyConnectedLayer(uint32_t input_size, uint32_t neural_num, uint32_t crossbar_size, Interconnect *ic, std::string type);
+    using NeuralNetworkLayer::forward_propagation;
 
-    void set_bandwidth() override;
-    
-    void forward_propagation(std::vector<uint32_t> target_addresses) override;
+    // weight_bits 0 takes the bit precision of the interconnect
+    FullyConnectedLayer(uint32_t input_size, uint32_t neural_num, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits = 0);
 
-    void forward_propagation(uint32_t target_address) override;
+    void set_bandwidth() override;
 };
 
 class ConvolutionLayer: public NeuralNetworkLayer {
@@ -50,20 +125,25 @@ class ConvolutionLayer: public NeuralNetworkLayer {
     uint32_t kernel_size[3]; // 0-height, 1-width, 2-channel
     uint32_t stride;
     uint32_t pad;
-    bool mapping_flag = true; // true: k2col; false: im2col
+    bool mapping_flag = ic->getConfig().conv_mapping == 0; // true: k2col; false: im2col
+    bool line_buffer = ic->getConfig().conv_mapping == 2;  // im2col only resends the pixels a window step brings in
     Im2col _im2col;
+
+    uint32_t compute() override;
+    std::string cache_signature() override;
+
     public:
-    ConvolutionLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t stride, uint32_t pad, uint32_t crossbar_size, Interconnect *ic, std::string type);
+    using NeuralNetworkLayer::forward_propagation;
+
+    ConvolutionLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t stride, uint32_t pad, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits = 0);
 
     std::vector<uint32_t> get_input_addr() override;
 
     uint32_t set_up(Component* component, uint32_t data_size) override;
 
     void set_bandwidth() override;
-    
-    void forward_propagation(std::vector<uint32_t> target_addresses) override;
 
-    void forward_propagation(uint32_t target_address) override;
+    void set_planes(uint32_t input_planes, uint32_t output_planes) override;
 };
 
 class PoolingLayer: public NeuralNetworkLayer {
@@ -71,12 +151,24 @@ class PoolingLayer: public NeuralNetworkLayer {
     uint32_t input_size[3]; // 0-height, 1-width, 2-channel
     uint32_t kernel_size[3]; // 0-height, 1-width, 2-channel
     Pool _pool;
+    std::unique_ptr<Pool> saved_pool;
+
+    uint32_t compute() override;
+    void connect_outputs(std::vector<uint32_t> target_addresses) override;
+    uint32_t send_outputs(std::vector<uint32_t> target_addresses) override;
+
     public:
+    using NeuralNetworkLayer::forward_propagation;
+
     PoolingLayer(uint32_t input_size[3], uint32_t kernel_size[3], uint32_t crossbar_size, Interconnect *ic, std::string type);
 
     std::vector<uint32_t> get_input_addr() override;
-    
-    void forward_propagation(std::vector<uint32_t> target_addresses) override;
+
+    void set_sparsity(double zero_fraction) override;
+    void set_planes(uint32_t input_planes, uint32_t output_planes) override;
+
+    void save_state() override;
+    void restore_state() override;
 
     void forward_propagation(uint32_t target_address) override;
 };
@@ -84,10 +176,73 @@ class PoolingLayer: public NeuralNetworkLayer {
 class FlattenLayer: public NeuralNetworkLayer {
     private:
     Flatten _flatten;
+
+    void connect_outputs(std::vector<uint32_t> target_addresses) override;
+    uint32_t send_outputs(std::vector<uint32_t> target_addresses) override;
+
     public:
     FlattenLayer(uint32_t crossbar_size, Interconnect *ic);
 
     std::vector<uint32_t> get_input_addr() override;
 
-    void forward_propagation(std::vector<uint32_t> target_addresses) override;
-};
\ No newline at end of file
+    void set_sparsity(double zero_fraction) override;
+    void set_planes(uint32_t input_planes, uint32_t output_planes) override;
+};
+
+class MergeLayer: public NeuralNetworkLayer {
+    private:
+    Merge _merge;
+
+    void connect_outputs(std::vector<uint32_t> target_addresses) override;
+    uint32_t send_outputs(std::vector<uint32_t> target_addresses) override;
+
+    public:
+    using NeuralNetworkLayer::forward_propagation;
+
+    MergeLayer(uint32_t input_num, uint32_t crossbar_size, Interconnect *ic, std::string type);
+
+    std::vector<uint32_t> get_input_addr() override;
+
+    void set_sparsity(double zero_fraction) override;
+    void set_planes(uint32_t input_planes, uint32_t output_planes) override;
+
+    void forward_propagation(uint32_t target_address) override;
+};
+
+// Product of two activation tensors, e.g. Q·Kᵀ and softmax·V of attention.
+// Every token (height x width position) of the first operand is a row of
+// channel features. The second operand is written into the crossbars as
+// weights each time the layer runs, then the tokens of the first stream
+// through them. heads splits the product into independent ones side by side;
+// a "softmax" activation normalizes every output row of a head.
+class MatMulLayer: public NeuralNetworkLayer {
+    private:
+    uint32_t tokens;        // rows of the first operand
+    uint32_t depth;         // shared dimension of one head
+    uint32_t columns;       // output features of one head
+    uint32_t heads;
+    bool softmax;
+    OperandBuffer _operands;
+    ArenaArray<Softmax> reducers;   // one per head spread over several activation units
+
+    // Writeback of the second operand and the cell writes, the first stage
+    uint32_t write_weights();
+    uint32_t reduce_softmax();
+
+    uint32_t compute() override;
+    std::string cache_signature() override;
+
+    public:
+    using NeuralNetworkLayer::forward_propagation;
+
+    // weight_bits is the precision of the second operand
+    MatMulLayer(uint32_t tokens, uint32_t depth, uint32_t columns, uint32_t heads, uint32_t crossbar_size, Interconnect *ic, std::string type, uint32_t weight_bits);
+
+    std::vector<uint32_t> get_input_addr() override;
+
+    uint32_t set_up(Component* component, uint32_t data_size) override;
+
+    void set_bandwidth() override;
+
+    void set_planes(uint32_t input_planes, uint32_t output_planes) override;
+};
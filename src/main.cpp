@@ -1,56 +1,177 @@
-#include "model.hpp"
+#include "model_loader.hpp"
+#include "networks.hpp"
+#include "bandwidth_solver.hpp"
+#include "pareto.hpp"
+#include "report.hpp"
 #include <sstream>
+#include <filesystem>
 
-// Main Simulation
-int main() {
+// Builds and runs one model, on a single interconnect or on a board of CHIP_NUM chips
+void simulate(const std::array<uint32_t, 3>& input_size, const std::function<void(Model&)>& build,
+              const std::string& dot_file, const std::string& report_file, LayerCache* cache = nullptr) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::string file_name = "network.dot";
-    Interconnect interconnect(file_name);
-    Host host = Host(64*1024*8, &interconnect);
-    interconnect.registerComponent(&host);
-    Model model({28, 28, 1}, CROSSBAR_SIZE, &host, &interconnect);
-
-    // model.Conv(3, 3, 32)
-    //      .MaxPool(2, 2)
-    //      .Conv(3, 3, 64)
-    //      .MaxPool(2, 2)
-    //      .Conv(3, 3, 64)
+    Simulation simulation(input_size, dot_file, SimConfig(), cache);
+    build(simulation.getModel());
+    simulation.getModel().forward();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+    writeReport(report_file, simulation.getInterconnect(), simulation.getModel(), duration, simulation.getBoard(),
+                simulation.getBoard() ? nullptr : cache);
+}
+
+// Simulates one JSON model description, report goes to ./results/<name>/
+void simulateFile(const std::string& model_file, LayerCache* cache) {
+    ModelDescription description = loadModelDescription(model_file);
+    std::string result_dir = "./results/" + description.name;
+    std::filesystem::create_directories(result_dir);
+
+    std::stringstream filenameStream;
+    filenameStream << result_dir << "/" << CROSSBAR_SIZE << "-" << BIT_PRECISION << "-" << BANDWIDTH << ".txt";
+    simulate(description.input_size, [&](Model& model) { buildModel(description, model); },
+             result_dir + "/network.dot", filenameStream.str(), cache);
+}
+
+// Searches the cheapest link bandwidths meeting the target, up to BANDWIDTH per link
+void solveBandwidth(const std::string& name, const std::array<uint32_t, 3>& input_size,
+                    const std::function<void(Model&)>& build, uint32_t target, BandwidthTarget kind, LayerCache* cache) {
+    const char* class_names[LINK_CLASS_NUM] = {"CB_ACC", "ACC_ACT", "IM_CB", "LAYER"};
+    BandwidthSolution solution = solveMinBandwidth(simulationEvaluator(input_size, build, cache), target, BANDWIDTH, kind);
+
+    const char* metric = kind == BandwidthTarget::Delay ? "delay" : "initiation interval";
+    std::cout << name << ": target " << metric << " " << target << " unit time, " << solution.evaluations << " simulations\n";
+    if (!solution.feasible) {
+        std::cout << "  Not reachable, " << metric << " is "
+                  << (kind == BandwidthTarget::Delay ? solution.delay : solution.interval)
+                  << " unit time at " << BANDWIDTH << " bits per unit time" << std::endl;
+        return;
+    }
+    for (uint32_t c = 0; c < LINK_CLASS_NUM; c++) {
+        std::cout << "  " << class_names[c] << ": " << solution.bandwidth[c] << " bits per unit time on " << solution.links[c] << " links\n";
+    }
+    std::cout << "  Delay: " << solution.delay << " unit time\n"
+              << "  Initiation Interval: " << solution.interval << " unit time\n"
+              << "  Provisioned Bandwidth: " << solution.cost << " bits per unit time" << std::endl;
+}
+
+// Pareto front over the design grid of delay_test.sh, written to ./results/<name>/pareto.csv
+void exploreDesigns(const std::string& name, const std::array<uint32_t, 3>& input_size,
+                    const std::function<void(Model&)>& build, LayerCache* cache) {
+    DesignSpace space;
+    space.crossbar_sizes = {32, 64, 128, 256, 512, 1024};
+    space.bit_precisions = {1, 4, 8};
+    space.bandwidths = {16, 32, 64, 128, 256, 512, 1024};
+    space.mappings = {0, 1, 2};
+    uint32_t grid = space.crossbar_sizes.size() * space.bit_precisions.size() * space.bandwidths.size() * space.mappings.size();
+
+    uint32_t evaluations = 0;
+    std::vector<DesignPoint> front = paretoFront(space, designEvaluator(input_size, build, cache), evaluations);
+
+    std::string result_dir = "./results/" + name;
+    std::filesystem::create_directories(result_dir);
+    std::ofstream csv(result_dir + "/pareto.csv");
+    csv << "crossbar_size,bit_precision,bandwidth,mapping,delay,crossbars,total_bits\n";
+    std::cout << name << ": " << front.size() << " Pareto designs from " << evaluations << " of " << grid << " simulations\n";
+    for (auto& p: front) {
+        csv << p.config.crossbar_size << "," << p.config.bit_precision << "," << p.config.bandwidth << ","
+            << p.config.conv_mapping << "," << p.delay << "," << p.crossbars << "," << p.total_bits << "\n";
+        std::cout << "  " << p.config.crossbar_size << "-" << p.config.bit_precision << "-" << p.config.bandwidth
+                  << " mapping " << p.config.conv_mapping << ": delay " << p.delay << ", " << p.crossbars
+                  << " crossbars, " << p.total_bits << " bits\n";
+    }
+    std::cout.flush();
+}
+
+void buildDefault(Model& model) {
+    buildMLP(model);
+
+    // buildCNN(model);
+
+    // Residual block: the two branches run concurrently and Add joins them
+    // model.Conv(3, 3, 16, 1, 1).As("x")
+    //      .Conv(3, 3, 16, 1, 1)
+    //      .Conv(3, 3, 16, 1, 1).As("y")
+    //      .Add({"x", "y"})
     //      .Flatten()
-    //      .Dense(64)
     //      .Dense(10);
-    
-    model.Dense(512)
-        .Dense(32)
-        .Dense(10);
+}
 
-    //model.Dense(128)
-    //.Dense(10);
+// Main Simulation
+// Usage: ./main [model.json ...]   (no model file runs the built-in network)
+//        ./main --target-delay N [model.json ...]        cheapest link bandwidths for a delay
+//        ./main --target-throughput X [model.json ...]   same for the initiation interval, X inferences per unit time
+//        ./main --pareto [model.json ...]                 Pareto front of the design space
+//        --cache FILE with any of them keeps layer results in FILE between runs
+int main(int argc, char* argv[]) {
+    uint32_t target = 0;
+    BandwidthTarget target_kind = BandwidthTarget::Delay;
+    bool pareto = false;
+    std::string cache_file;
+    std::vector<std::string> model_files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pareto") {
+            pareto = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_file = argv[++i];
+        } else if ((arg == "--target-delay" || arg == "--target-throughput") && i + 1 < argc) {
+            double value = std::stod(argv[++i]);
+            // Pipelined inputs enter once per initiation interval, which has to fit 1/X
+            if (arg == "--target-throughput") {
+                target_kind = BandwidthTarget::Interval;
+                value = value > 0 ? 1.0 / value : 0;
+            }
+            if (value < 1 || value > std::numeric_limits<uint32_t>::max()) {
+                std::cout << "Target is out of range!" << std::endl;
+                exit(1);
+            }
+            target = static_cast<uint32_t>(value);
+        } else {
+            model_files.push_back(arg);
+        }
+    }
 
-    model.forward();
+    // Sweeps always share layer results in memory, single runs only with --cache
+    LayerCache cache;
+    if (!cache_file.empty()) cache.load(cache_file);
+    LayerCache* single_run_cache = cache_file.empty() ? nullptr : &cache;
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    if (pareto) {
+        if (model_files.empty()) {
+            exploreDesigns("built-in", {28, 28, 1}, buildDefault, &cache);
+        }
+        for (auto& file: model_files) {
+            ModelDescription description = loadModelDescription(file);
+            exploreDesigns(description.name, description.input_size,
+                           [&](Model& model) { buildModel(description, model); }, &cache);
+        }
+    } else if (target) {
+        if (model_files.empty()) {
+            solveBandwidth("built-in", {28, 28, 1}, buildDefault, target, target_kind, &cache);
+        }
+        for (auto& file: model_files) {
+            ModelDescription description = loadModelDescription(file);
+            solveBandwidth(description.name, description.input_size,
+                           [&](Model& model) { buildModel(description, model); }, target, target_kind, &cache);
+        }
+    } else if (!model_files.empty()) {
+        for (auto& file: model_files) {
+            simulateFile(file, single_run_cache);
+        }
+    } else {
+        // Construct filename based on parameters
+        std::stringstream filenameStream;
+        // filenameStream << "./cnn-k2col/" << CROSSBAR_SIZE << "-" << BIT_PRECISION << ".txt";
+        filenameStream << "./var_network_bw_with_cp_bw/fc/" << CROSSBAR_SIZE << "-" << BIT_PRECISION << "-" << BANDWIDTH << ".txt";
+        std::string filename = filenameStream.str();
 
-    // Construct filename based on parameters
-    std::stringstream filenameStream;
-    // filenameStream << "./cnn-k2col/" << CROSSBAR_SIZE << "-" << BIT_PRECISION << ".txt";
-    filenameStream << "./var_network_bw_with_cp_bw/fc/" << CROSSBAR_SIZE << "-" << BIT_PRECISION << "-" << BANDWIDTH << ".txt";
-    std::string filename = filenameStream.str();
-
-    std::ofstream dotFile;
-    dotFile.open(filename);
-    // dotFile.open("report.txt");
-    dotFile << "Crossbar Size: " << CROSSBAR_SIZE << "*" << CROSSBAR_SIZE << "\n"
-    << "Bit Precision: " << BIT_PRECISION << "\n"
-    << "Crossbar Amount: " << interconnect.getCrossbarNum() << "\n"
-    << "Crossbar Usage Proportion: " << interconnect.getCrossbarUsage() << "\n"
-    << "Bandwidth: " << BANDWIDTH << " bits per unit time\n"
-    << "Required Minimum Bandwidth: " << interconnect.getMinBandwidth() << " bits per unit time\n"
-    << "Delay: " << model.get_delay() << " unit time\n"
-    << "Total Bits transferred: " << interconnect.getTotalBits() << " bits\n\n"
-    << "Sim Time Cost: " << duration.count() << "e-6 s\n";
-    dotFile.close();
+        // writeReport("report.txt", interconnect, model, duration);
+        simulate({28, 28, 1}, buildDefault, "network.dot", filename, single_run_cache);
+    }
+
+    if (!cache_file.empty()) cache.save(cache_file);
     return 0;
 }
 
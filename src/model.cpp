@@ -1,4 +1,6 @@
 #include "model.hpp"
+#include <map>
+#include <queue>
 
 
 Model::Model(const std::array<uint32_t, 3>& input_size, uint32_t cs, Host* h, Interconnect* ic)
@@ -9,20 +11,111 @@ Model::Model(const std::array<uint32_t, 3>& input_size, uint32_t cs, Host* h, In
     this->input_size[0] = input_size[0];
     this->input_size[1] = input_size[1];
     this->input_size[2] = input_size[2];
+
+    Tensor input;
+    input.producer = -1;
+    std::copy(current_size, current_size + 3, input.shape);
+    input.planes = interconnect->getPlanes();
+    tensors["input"] = input;
+    current = "input";
+    // Rate-coded input spikes
+    if (SNN_TIMESTEPS) host->setSparsity(1.0 - SNN_FIRING_RATE);
+}
+
+Model& Model::addLayer(LayerBuilder builder, const std::vector<std::string>& inputs, const uint32_t output[3],
+                       uint32_t output_planes, const LayerPrecision& precision) {
+    std::vector<int> producers;
+    uint32_t input_planes = tensors[inputs[0]].planes;
+    for (auto& name: inputs) {
+        producers.push_back(tensors[name].producer);
+        if (tensors[name].planes != input_planes) {
+            fail("Layer inputs need the same activation precision: ", name);
+        }
+    }
+    precisions.push_back(precision);
+    layer_planes.push_back({input_planes, output_planes});
+    layers.push_back(nullptr);
+    builders.push_back(std::move(builder));
+    layer_arenas.emplace_back();
+    layer_addrs.push_back({0, 0});
+    sparsity.emplace_back();
+    layer_inputs.push_back(producers);
+    // Streamed layers are built when they are about to run or receive
+    if (!STREAM_LAYERS) build(layers.size() - 1);
+    // Every output spikes at the firing rate until set_sparsity() says otherwise
+    if (SNN_TIMESTEPS) set_layer_sparsity(layers.size() - 1, 1.0 - SNN_FIRING_RATE);
+
+    Tensor tensor;
+    tensor.producer = static_cast<int>(layers.size()) - 1;
+    std::copy(output, output + 3, tensor.shape);
+    tensor.planes = output_planes;
+    current = "t" + std::to_string(tensor_count++);
+    tensors[current] = tensor;
+
+    std::copy(output, output + 3, current_size);
+    return *this;
 }
 
-Model& Model::Conv(uint32_t kh, uint32_t kw, uint32_t filters, uint32_t stride, uint32_t pad, const std::string& act) {
+uint32_t Model::planes_for(uint32_t act_bits) {
+    return act_bits && !SNN_TIMESTEPS ? act_bits : interconnect->getPlanes();
+}
+
+void Model::build(size_t i) {
+    interconnect->setOwner(static_cast<int>(i));
+    // A streamed layer gets its own arena and a contiguous address range, so
+    // release() can free both
+    if (STREAM_LAYERS) {
+        layer_arenas[i].reset(new Arena());
+        interconnect->useArena(layer_arenas[i].get());
+    }
+    uint32_t begin = interconnect->getNextAddr();
+    layers[i] = builders[i](interconnect);
+    builders[i] = nullptr;
+    layers[i]->set_planes(layer_planes[i].first, layer_planes[i].second);
+    if (!STREAM_LAYERS) return;
+
+    layer_addrs[i] = {begin, interconnect->getNextAddr()};
+    interconnect->useArena(nullptr);
+    if (sparsity[i]) layers[i]->set_sparsity(*sparsity[i]);
+
+    live_layers++;
+    live_bytes += layer_arenas[i]->getAllocatedBytes();
+    peak_live_layers = std::max(peak_live_layers, live_layers);
+    peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+}
+
+void Model::release(size_t i) {
+    interconnect->release(layer_addrs[i].first, layer_addrs[i].second);
+    live_layers--;
+    live_bytes -= layer_arenas[i]->getAllocatedBytes();
+    layers[i] = nullptr;
+    layer_arenas[i].reset();
+}
+
+void Model::set_layer_sparsity(size_t i, double zero_fraction) {
+    if (layers[i]) {
+        layers[i]->set_sparsity(zero_fraction);
+    } else {
+        sparsity[i] = zero_fraction;
+    }
+}
+
+Model& Model::Conv(uint32_t kh, uint32_t kw, uint32_t filters, uint32_t stride, uint32_t pad, const std::string& act,
+                   uint32_t weight_bits, uint32_t act_bits) {
+    if (weight_bits > crossbar_size) {
+        fail("Weight precision exceeds the crossbar size!");
+    }
     uint32_t kernel[3] = {kh, kw, filters};
     uint32_t output[3] = {
         (current_size[0] + 2 * pad - kh) / stride + 1,
         (current_size[1] + 2 * pad - kw) / stride + 1,
         filters
     };
-    auto* conv = new ConvolutionLayer(current_size, kernel, stride, pad, crossbar_size, interconnect, act);
-    layers.push_back(conv);
-
-    std::copy(output, output + 3, current_size);
-    return *this;
+    uint32_t input[3] = {current_size[0], current_size[1], current_size[2]};
+    uint32_t cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) mutable {
+        return ic->getArena().create<ConvolutionLayer>(input, kernel, stride, pad, cs, ic, act, weight_bits);
+    }, {current}, output, planes_for(act_bits), {weight_bits, act_bits});
 }
 
 Model& Model::MaxPool(uint32_t ph, uint32_t pw) {
@@ -32,55 +125,508 @@ Model& Model::MaxPool(uint32_t ph, uint32_t pw) {
         current_size[1] / pw,
         current_size[2]
     };
-    auto* pool = new PoolingLayer(current_size, kernel, crossbar_size, interconnect, "Max");
-    layers.push_back(pool);
-
-    std::copy(output, output + 3, current_size);
-    return *this;
+    uint32_t input[3] = {current_size[0], current_size[1], current_size[2]};
+    uint32_t cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) mutable {
+        return ic->getArena().create<PoolingLayer>(input, kernel, cs, ic, "Max");
+    }, {current}, output, tensors[current].planes);
 }
 
 Model& Model::Flatten() {
-    auto* flatten = new FlattenLayer(crossbar_size, interconnect);
-    layers.push_back(flatten);
+    uint32_t output[3];
+    output[0] = 1;
+    output[1] = 1;
+    output[2] = current_size[0] * current_size[1] * current_size[2]; // flattens to 1D
+    uint32_t cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) { return ic->getArena().create<FlattenLayer>(cs, ic); }, {current}, output,
+                    tensors[current].planes);
+}
+
+Model& Model::Dense(uint32_t out_features, const std::string& act, uint32_t weight_bits, uint32_t act_bits) {
+    if (weight_bits > crossbar_size) {
+        fail("Weight precision exceeds the crossbar size!");
+    }
+    uint32_t in_features = current_size[0] * current_size[1] * current_size[2];
+    uint32_t output[3] = {1, 1, out_features};
+    uint32_t cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) {
+        return ic->getArena().create<FullyConnectedLayer>(in_features, out_features, cs, ic, act, weight_bits);
+    }, {current}, output, planes_for(act_bits), {weight_bits, act_bits});
+}
+
+Model& Model::Add(const std::vector<std::string>& inputs) {
+    if (inputs.size() < 2) {
+        fail("Add needs at least two inputs!");
+    }
+    From(inputs[0]);
+    for (auto& name: inputs) {
+        const Tensor& tensor = tensors[name];
+        if (!std::equal(tensor.shape, tensor.shape + 3, current_size)) {
+            fail("Add input shape mismatch: ", name);
+        }
+    }
+    uint32_t output[3];
+    std::copy(current_size, current_size + 3, output);
+    uint32_t input_num = inputs.size(), cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) { return ic->getArena().create<MergeLayer>(input_num, cs, ic, "Add"); }, inputs, output,
+                    tensors[current].planes);
+}
+
+Model& Model::Concat(const std::vector<std::string>& inputs) {
+    if (inputs.size() < 2) {
+        fail("Concat needs at least two inputs!");
+    }
+    From(inputs[0]);
+    uint32_t output[3] = {current_size[0], current_size[1], 0};
+    for (auto& name: inputs) {
+        const Tensor& tensor = tensors[name];
+        if (tensor.shape[0] != output[0] || tensor.shape[1] != output[1]) {
+            fail("Concat input shape mismatch: ", name);
+        }
+        output[2] += tensor.shape[2];
+    }
+    uint32_t input_num = inputs.size(), cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) { return ic->getArena().create<MergeLayer>(input_num, cs, ic, "Concat"); }, inputs, output,
+                    tensors[current].planes);
+}
+
+Model& Model::MatMul(const std::vector<std::string>& inputs, bool transpose, uint32_t heads, const std::string& act) {
+    if (inputs.size() != 2) {
+        fail("MatMul needs two inputs!");
+    }
+    From(inputs[1]);
+    From(inputs[0]);
+    const Tensor& b = tensors[inputs[1]];
+    uint32_t tokens = current_size[0] * current_size[1];
+    uint32_t features = current_size[2];
+    uint32_t b_tokens = b.shape[0] * b.shape[1];
+    if (heads == 0 || features % heads) {
+        fail("MatMul heads must divide the input features!");
+    }
+    // Every head multiplies its features of the first input with its block of the second
+    uint32_t depth = features / heads;
+    uint32_t columns = transpose ? b_tokens : b.shape[2] / heads;
+    if (transpose ? b.shape[2] != features : depth != b_tokens || b.shape[2] % heads) {
+        fail("MatMul input shape mismatch: ", inputs[1]);
+    }
+    if (b.planes > crossbar_size) {
+        fail("Weight precision exceeds the crossbar size!");
+    }
+    uint32_t output[3] = {current_size[0], current_size[1], columns * heads};
+    uint32_t weight_bits = b.planes, cs = crossbar_size;
+    return addLayer([=](Interconnect* ic) {
+        return ic->getArena().create<MatMulLayer>(tokens, depth, columns, heads, cs, ic, act, weight_bits);
+    }, inputs, output, tensors[current].planes);
+}
 
-    current_size[0] = 1;
-    current_size[1] = 1;
-    current_size[2] = current_size[0] * current_size[1] * current_size[2]; // flattens to 1D
+Model& Model::MultiHeadAttention(uint32_t heads) {
+    uint32_t features = current_size[2];
+    if (heads == 0 || features % heads) {
+        fail("Attention heads must divide the features!");
+    }
+    std::string x = current;
+    Conv(1, 1, features, 1, 0, "none");
+    std::string q = current;
+    From(x).Conv(1, 1, features, 1, 0, "none");
+    std::string k = current;
+    From(x).Conv(1, 1, features, 1, 0, "none");
+    std::string v = current;
+    MatMul({q, k}, true, heads, "softmax");
+    MatMul({current, v}, false, heads);
+    return Conv(1, 1, features, 1, 0, "none");
+}
+
+Model& Model::Sparsity(double zero_fraction) {
+    if (layers.empty()) {
+        fail("Sparsity needs a layer to apply to!");
+    }
+    set_layer_sparsity(layers.size() - 1, zero_fraction);
     return *this;
 }
 
-Model& Model::Dense(uint32_t out_features, const std::string& act) {
-    uint32_t in_features = current_size[0] * current_size[1] * current_size[2];
-    auto* fc = new FullyConnectedLayer(in_features, out_features, crossbar_size, interconnect, act);
-    layers.push_back(fc);
+Model& Model::From(const std::string& tensor) {
+    if (tensors.find(tensor) == tensors.end()) {
+        fail("Cannot find tensor: ", tensor);
+    }
+    current = tensor;
+    std::copy(tensors[tensor].shape, tensors[tensor].shape + 3, current_size);
+    return *this;
+}
 
-    current_size[2] = out_features;
-    current_size[0] = current_size[1] = 1;
+Model& Model::As(const std::string& tensor) {
+    if (tensors.find(tensor) != tensors.end()) {
+        fail("Tensor already defined: ", tensor);
+    }
+    tensors[tensor] = tensors[current];
+    current = tensor;
     return *this;
 }
 
-void Model::forward() {
-    if (auto* conv = dynamic_cast<ConvolutionLayer*>(layers[0])) {
-        this->delay += conv->set_up(host, input_size[0] * input_size[1]);
-    } else if (auto* fc = dynamic_cast<FullyConnectedLayer*>(layers[0])) {
-        this->delay += fc->set_up(host, input_size[0] * input_size[1]);
+// Kahn's algorithm over the layer graph; ties keep construction order
+std::vector<size_t> Model::schedule() {
+    std::vector<uint32_t> in_degree(layers.size(), 0);
+    std::vector<std::vector<size_t>> consumers(layers.size());
+    for (size_t i = 0; i < layers.size(); ++i) {
+        for (int p: layer_inputs[i]) {
+            if (p >= 0) {
+                consumers[p].push_back(i);
+                in_degree[i]++;
+            }
+        }
+    }
+
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (in_degree[i] == 0) ready.push(i);
+    }
+
+    std::vector<size_t> order;
+    while (!ready.empty()) {
+        size_t i = ready.top();
+        ready.pop();
+        order.push_back(i);
+        for (size_t c: consumers[i]) {
+            if (--in_degree[c] == 0) ready.push(c);
+        }
+    }
+    if (order.size() != layers.size()) {
+        fail("Model graph has a cycle!");
+    }
+    return order;
+}
+
+void Model::run(size_t i) {
+    interconnect->setOwner(static_cast<int>(i));
+    setup_times[i] = 0;
+    for (int p: layer_inputs[i]) {
+        if (p >= 0) {
+            continue;
+        } else if (auto* conv = dynamic_cast<ConvolutionLayer*>(layers[i])) {
+            setup_times[i] = std::max(setup_times[i], input_load + conv->set_up(host, input_size[0] * input_size[1]));
+        } else if (auto* fc = dynamic_cast<FullyConnectedLayer*>(layers[i])) {
+            setup_times[i] = std::max(setup_times[i], input_load + fc->set_up(host, input_size[0] * input_size[1]));
+        } else if (auto* matmul = dynamic_cast<MatMulLayer*>(layers[i])) {
+            setup_times[i] = std::max(setup_times[i], input_load + matmul->set_up(host, input_size[0] * input_size[1] * input_size[2]));
+        } else {
+            std::cerr << "Unknown component type for connection.\n";
+        }
+    }
+
+    if (consumers[i].empty()) {
+        // Final layer output goes to host
+        layers[i]->forward_propagation(host->getAddress());
     } else {
-        std::cerr << "Unknown component type for connection.\n";
+        std::vector<std::vector<uint32_t>> target_groups;
+        for (size_t c: consumers[i]) {
+            target_groups.push_back(layers[c]->get_input_addr());
+        }
+        if (buffers.empty()) {
+            layers[i]->forward_propagation(target_groups);
+        } else {
+            buffers[i]->expect(output_bits[i]);
+            interconnect->routeThrough(buffers[i], target_groups);
+            layers[i]->forward_propagation(target_groups);
+            interconnect->routeThrough(nullptr, {});
+        }
+    }
+    interconnect->setOwner(-1);
+
+    NeuralNetworkLayer* layer = layers[i];
+    summaries[i] = {{layer->get_crossbar_num(), layer->get_weight_bits(), layer->get_program_rows(), layer->get_delay()},
+                    layer->get_overlap_saved(), layer->get_critical_sends(), layer->get_write_delay()};
+}
+
+void Model::forward() {
+    if (STREAM_LAYERS && (CHIP_NUM > 1 || interconnect->isTracking())) {
+        fail("Streaming layers needs a single chip and no incremental updates!");
+    }
+    if (streamed) {
+        fail("The streamed layers are released, build the model again to rerun it!");
+    }
+    consumers.assign(layers.size(), {});
+    for (size_t i = 0; i < layers.size(); ++i) {
+        for (int p: layer_inputs[i]) {
+            if (p >= 0) consumers[p].push_back(i);
+        }
     }
 
-    for (size_t i = 1; i < layers.size(); ++i) {
-        layers[i-1]->forward_propagation(layers[i]->get_input_addr());
-        this->delay += layers[i-1]->get_delay();
+    output_bits.assign(layers.size(), 0);
+    for (auto& [name, tensor]: tensors) {
+        if (tensor.producer < 0) continue;
+        output_bits[tensor.producer] = static_cast<uint64_t>(tensor.shape[0]) * tensor.shape[1] * tensor.shape[2] * tensor.planes;
     }
+    // The input is read once, however many layers it feeds
+    input_load = host->access(static_cast<uint64_t>(input_size[0]) * input_size[1] * input_size[2] * interconnect->getPlanes());
 
-    // Final layer output goes to host
-    layers.back()->forward_propagation(host->getAddress());
-    this->delay += layers.back()->get_delay();
+    if (BUFFER_BITS && buffers.empty()) {
+        buffers.assign(layers.size(), nullptr);
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (consumers[i].empty()) continue;
+            interconnect->setOwner(static_cast<int>(i));
+            buffers[i] = interconnect->getArena().create<Buffer>(BUFFER_BITS, BUFFER_BANKS, interconnect);
+            interconnect->registerComponent(buffers[i]);
+        }
+        interconnect->setOwner(-1);
+    }
+
+    // Layer delays do not depend on when the layers start, so every layer is
+    // simulated first and the timeline is laid out once residency is known.
+    std::vector<size_t> order = schedule();
+    setup_times.assign(layers.size(), 0);
+    summaries.assign(layers.size(), {});
+    bool tracking = interconnect->isTracking();
+    if (tracking) layer_traffic.assign(layers.size(), TrafficTotals());
+    for (size_t i: order) {
+        if (STREAM_LAYERS) {
+            // Only the layer and the consumers it sends to are alive while it runs
+            if (!layers[i]) build(i);
+            for (size_t c: consumers[i]) {
+                if (!layers[c]) build(c);
+            }
+            run(i);
+            release(i);
+            continue;
+        }
+        if (!tracking) {
+            run(i);
+            continue;
+        }
+        layers[i]->save_state();
+        TrafficTotals before = interconnect->takeTotals();
+        run(i);
+        layer_traffic[i] = interconnect->takeTotals();
+        interconnect->addTotals(before);
+        interconnect->addTotals(layer_traffic[i]);
+    }
+    streamed = STREAM_LAYERS;
+    layout(order);
+}
+
+void Model::layout(const std::vector<size_t>& order) {
+    std::vector<LayerWeights> weights;
+    for (auto& summary: summaries) weights.push_back(summary.weights);
+    residency = planResidency(weights, crossbar_pool, WRITE_BW, ROW_PROGRAM_LATENCY);
+
+    // Every layer starts once all of its inputs are ready, so independent
+    // branches overlap and the model delay is the critical path. Time-shared
+    // layers take turns on the free crossbars; the first pass is written while
+    // their inputs are still being computed.
+    finish_times.assign(layers.size(), 0);
+    delay = 0;
+    program_delay = 0;
+    programmed_bits = 0;
+    uint32_t shared_free = 0;
+    start_times.assign(layers.size(), 0);
+    critical_inputs.assign(layers.size(), {});
+    buffer_stalls.assign(layers.size(), 0);
+    for (size_t i: order) {
+        // The input that arrives last starts the layer, the one before it sets the slack
+        auto ready = [&](int p) { return p >= 0 ? finish_times[p] : setup_times[i]; };
+        uint32_t start = setup_times[i];
+        CriticalInput& critical = critical_inputs[i];
+        for (int p: layer_inputs[i]) {
+            if (critical.input == NO_INPUT || ready(p) > ready(critical.input)) {
+                critical.runner_up = critical.input;
+                critical.input = p;
+            } else if (critical.runner_up == NO_INPUT || ready(p) > ready(critical.runner_up)) {
+                critical.runner_up = p;
+            }
+            start = std::max(start, ready(p));
+        }
+        if (critical.runner_up != NO_INPUT) critical.slack = ready(critical.input) - ready(critical.runner_up);
+
+        // An undersized output buffer holds the layer back until enough is read out
+        if (!buffers.empty() && buffers[i]) buffer_stalls[i] = buffers[i]->getStall();
+        uint32_t delay = weights[i].delay + buffer_stalls[i];
+        if (residency[i].resident) {
+            finish_times[i] = start + delay;
+        } else {
+            uint32_t passes = residency[i].passes;
+            uint32_t write = residency[i].program_delay;
+            start = std::max(start, shared_free + write);
+            finish_times[i] = start + delay + (passes - 1) * (write + delay);
+            shared_free = finish_times[i];
+            program_delay += static_cast<uint64_t>(passes) * write;
+            programmed_bits += weights[i].bits;
+        }
+        start_times[i] = start;
+    }
+
+    // Outputs are written back to the host DRAM in the order they finish
+    std::vector<size_t> sinks;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (consumers[i].empty()) sinks.push_back(i);
+    }
+    std::stable_sort(sinks.begin(), sinks.end(), [&](size_t a, size_t b) { return finish_times[a] < finish_times[b]; });
+    uint32_t dram_free = 0;
+    output_drain = 0;
+    critical_output = {};
+    std::vector<uint32_t> written_times(layers.size(), 0);
+    for (size_t i: sinks) {
+        uint32_t drain = host->access(output_bits[i]);
+        uint32_t written = std::max(finish_times[i], dram_free) + drain;
+        if (drain) dram_free = written;
+        output_drain += drain;
+        this->delay = std::max(this->delay, written);
+        written_times[i] = written;
+    }
+    // The output written last ends the critical path
+    for (size_t i: sinks) {
+        int sink = static_cast<int>(i);
+        if (critical_output.input == NO_INPUT || written_times[i] > written_times[critical_output.input]) {
+            critical_output.runner_up = critical_output.input;
+            critical_output.input = sink;
+        } else if (critical_output.runner_up == NO_INPUT || written_times[i] > written_times[critical_output.runner_up]) {
+            critical_output.runner_up = sink;
+        }
+    }
+    if (critical_output.runner_up != NO_INPUT) {
+        critical_output.slack = written_times[critical_output.input] - written_times[critical_output.runner_up];
+    }
+
+    // Timesteps flow through the layers like a pipeline: each layer starts the
+    // next timestep once it is done with the current one, and the membrane
+    // state it integrates into stays in place, so only the spikes move
+    timestep_delay = this->delay;
+    initiation_interval = 0;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        initiation_interval = std::max(initiation_interval, finish_times[i] - start_times[i]);
+    }
+    timestep_interval = 0;
+    if (SNN_TIMESTEPS) {
+        // Every timestep reads its input spikes and writes its outputs through
+        // the same DRAM channels
+        uint32_t dram_busy = host->transfer(get_input_bits() / std::max<uint64_t>(SNN_TIMESTEPS, 1));
+        for (size_t i: sinks) dram_busy += host->transfer(output_bits[i]);
+        timestep_interval = std::max(initiation_interval, dram_busy);
+        this->delay += (SNN_TIMESTEPS - 1) * timestep_interval;
+    }
+
+    buffer_occupancy.clear();
+    if (buffers.empty()) return;
+    std::map<uint32_t, int64_t> changes;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (!buffers[i]) continue;
+        uint32_t end = 0;
+        for (size_t c: consumers[i]) end = std::max(end, finish_times[c]);
+        changes[start_times[i]] += buffers[i]->getStoredBits();
+        changes[end] -= buffers[i]->getStoredBits();
+    }
+    int64_t bits = 0;
+    for (auto& [time, change]: changes) {
+        if (!change) continue;
+        bits += change;
+        buffer_occupancy.push_back({time, static_cast<uint64_t>(bits)});
+    }
 }
 
+void Model::set_sparsity(const std::string& tensor, double zero_fraction) {
+    if (tensors.find(tensor) == tensors.end()) {
+        fail("Cannot find tensor: ", tensor);
+    }
+    int producer = tensors[tensor].producer;
+    if (producer < 0) {
+        fail("The model input has no sparsity to change!");
+    }
+    set_layer_sparsity(producer, zero_fraction);
+    interconnect->markDirty(producer);
+}
+
+uint32_t Model::update() {
+    if (!interconnect->isTracking()) {
+        fail("Incremental re-simulation needs tracking enabled before the model is built!");
+    }
+    std::set<int> dirty = interconnect->takeDirty();
+    std::vector<size_t> order = schedule();
+    // Edits change neither the size nor the count of any transfer, so the
+    // other layers keep their delays and only the timeline moves
+    interconnect->setReplay(true);
+    for (size_t i: order) {
+        if (!dirty.count(static_cast<int>(i))) continue;
+        layers[i]->restore_state();
+        interconnect->takeTotals();
+        run(i);
+        layer_traffic[i] = interconnect->takeTotals();
+    }
+    interconnect->setReplay(false);
+
+    interconnect->takeTotals();
+    for (auto& traffic: layer_traffic) interconnect->addTotals(traffic);
+    layout(order);
+    return dirty.size();
+}
+
+void Model::set_crossbar_pool(uint32_t crossbars) { crossbar_pool = crossbars; }
+
 uint32_t Model::get_delay() { return delay; }
+uint32_t Model::get_crossbar_pool() { return crossbar_pool; }
+
+uint32_t Model::get_resident_num() {
+    uint32_t resident = 0;
+    for (size_t i = 0; i < residency.size(); i++) {
+        if (residency[i].resident && summaries[i].weights.crossbars) resident++;
+    }
+    return resident;
+}
+
+uint64_t Model::get_program_delay() { return program_delay; }
+uint64_t Model::get_programmed_bits() { return programmed_bits; }
+
+uint64_t Model::get_overlap_saved() {
+    uint64_t saved = 0;
+    for (auto& summary: summaries) saved += summary.overlap_saved;
+    return saved;
+}
+
+Buffer* Model::get_buffer(size_t layer) { return buffers.empty() ? nullptr : buffers[layer]; }
+uint32_t Model::get_buffer_stall(size_t layer) { return buffer_stalls.empty() ? 0 : buffer_stalls[layer]; }
+size_t Model::get_layer_num() { return layers.size(); }
+
+LayerPrecision Model::get_precision(size_t layer) {
+    uint32_t weight_bits = precisions[layer].weight_bits;
+    return {weight_bits ? weight_bits : interconnect->getConfig().bit_precision, layer_planes[layer].second};
+}
+
+bool Model::is_mixed_precision() {
+    for (auto& precision: precisions) {
+        if (precision.weight_bits || precision.act_bits) return true;
+    }
+    return false;
+}
+const std::vector<std::pair<uint32_t, uint64_t>>& Model::get_buffer_occupancy() { return buffer_occupancy; }
+
+size_t Model::get_peak_live_layers() { return peak_live_layers; }
+uint64_t Model::get_peak_live_bytes() { return peak_live_bytes; }
 
-Model::~Model() {
-    for (auto* c : layers)
-        delete c;
+uint64_t Model::get_input_load() { return allTimesteps(input_load); }
+uint64_t Model::get_output_drain() { return allTimesteps(output_drain); }
+uint64_t Model::get_input_bits() {
+    return allTimesteps(static_cast<uint64_t>(input_size[0]) * input_size[1] * input_size[2] * interconnect->getPlanes());
 }
+uint64_t Model::get_output_bits() {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (consumers[i].empty()) bits += output_bits[i];
+    }
+    return allTimesteps(bits);
+}
+
+uint32_t Model::get_timestep_delay() { return timestep_delay; }
+uint32_t Model::get_timestep_interval() { return timestep_interval; }
+uint32_t Model::get_initiation_interval() { return initiation_interval; }
+
+std::vector<PathStep> Model::get_critical_path() {
+    std::vector<PathStep> path;
+    int layer = critical_output.input;
+    while (layer >= 0) {
+        const CriticalInput& input = critical_inputs[layer];
+        path.push_back({static_cast<size_t>(layer), start_times[layer], finish_times[layer], input.input,
+                        input.runner_up, input.slack});
+        layer = input.input;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+const CriticalInput& Model::get_critical_output() { return critical_output; }
+const LayerSummary& Model::get_summary(size_t layer) { return summaries[layer]; }
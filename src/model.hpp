@@ -1,5 +1,51 @@
 #pragma once
+#include <array>
+#include <memory>
+#include <optional>
 #include "layers.hpp"
+#include "residency.hpp"
+
+// Which input of a layer arrived last and so decided when it starts, and how
+// much later it was than the one before it
+constexpr int NO_INPUT = -2;
+struct CriticalInput {
+    int input = NO_INPUT;       // producing layer, -1 for the host
+    int runner_up = NO_INPUT;
+    uint32_t slack = 0;
+};
+
+// A layer on the critical path and the input it waited for
+struct PathStep {
+    size_t layer;
+    uint32_t start, finish;
+    int input;                  // -1 for the host
+    int runner_up;              // NO_INPUT if the layer has a single input
+    uint32_t slack;
+};
+
+// What is kept of a layer once it has run, see STREAM_LAYERS
+struct LayerSummary {
+    LayerWeights weights;
+    uint32_t overlap_saved = 0;
+    std::vector<CriticalSend> critical_sends;
+    uint32_t write_delay = 0;   // rewriting dynamic weights, see MatMulLayer
+};
+
+// Creates the components of one layer on the given interconnect
+using LayerBuilder = std::function<NeuralNetworkLayer*(Interconnect*)>;
+
+// Weight and activation precision a layer was given, 0 where it follows the interconnect
+struct LayerPrecision {
+    uint32_t weight_bits = 0;
+    uint32_t act_bits = 0;
+};
+
+// A named activation tensor in the model graph
+struct Tensor {
+    int producer;       // index into Model::layers, -1 for the model input
+    uint32_t shape[3];  // 0-height, 1-width, 2-channel
+    uint32_t planes;    // bit planes of every value
+};
 
 class Model {
     private:
@@ -9,23 +55,160 @@ class Model {
         uint32_t input_size[3];
         uint32_t current_size[3];
         uint32_t delay = 0;
-    
-        std::vector<NeuralNetworkLayer*> layers;
-    
+
+        std::vector<NeuralNetworkLayer*> layers;     // allocated from the interconnect arena, nullptr while streamed out
+        std::vector<LayerSummary> summaries;         // of every layer that has run
+        std::vector<std::vector<int>> layer_inputs;  // producers of each layer, -1 for the model input
+        std::vector<LayerPrecision> precisions;
+        std::vector<std::pair<uint32_t, uint32_t>> layer_planes;   // of the input and output activations
+        std::vector<uint32_t> finish_times;          // simulated completion time of each layer
+        std::vector<uint32_t> start_times;
+        std::vector<CriticalInput> critical_inputs;
+        CriticalInput critical_output;               // among the model outputs, by when they are written back
+        std::vector<std::vector<size_t>> consumers;
+        std::vector<uint32_t> setup_times;           // host to input layer transfers
+        std::vector<uint64_t> output_bits;           // output tensor of each layer
+        uint32_t input_load = 0;                     // reading one timestep of the model input from the host DRAM
+        uint32_t output_drain = 0;                   // writing one timestep of the model outputs back
+        uint32_t timestep_delay = 0;                 // one SNN timestep through the whole model
+        uint32_t timestep_interval = 0;              // between the timesteps, set by the slowest layer
+        uint32_t initiation_interval = 0;            // between two pipelined inputs, set by the slowest layer
+        std::vector<TrafficTotals> layer_traffic;    // kept when the interconnect tracks edits
+
+        std::unordered_map<std::string, Tensor> tensors;
+        std::string current;                         // tensor read by the next chained layer
+        uint32_t tensor_count = 0;
+
+        uint32_t crossbar_pool = CROSSBAR_POOL;      // 0-every layer keeps its own crossbars
+        std::vector<Residency> residency;
+        uint64_t program_delay = 0;
+        uint64_t programmed_bits = 0;
+
+        // Output buffer of every layer with consumers when BUFFER_BITS is set
+        std::vector<Buffer*> buffers;
+        std::vector<uint32_t> buffer_stalls;
+        std::vector<std::pair<uint32_t, uint64_t>> buffer_occupancy;
+
+        // Streaming: builders of the layers not built yet, the arena and
+        // address range of each live layer and the sparsity to give them
+        std::vector<LayerBuilder> builders;
+        std::vector<std::unique_ptr<Arena>> layer_arenas;
+        std::vector<std::pair<uint32_t, uint32_t>> layer_addrs;
+        std::vector<std::optional<double>> sparsity;
+        bool streamed = false;
+        size_t live_layers = 0, peak_live_layers = 0;
+        uint64_t live_bytes = 0, peak_live_bytes = 0;
+
+        // All inputs need the same planes, the output has output_planes
+        Model& addLayer(LayerBuilder builder, const std::vector<std::string>& inputs, const uint32_t output[3],
+                        uint32_t output_planes, const LayerPrecision& precision = {});
+        // Output planes of a layer with the given activation bits
+        uint32_t planes_for(uint32_t act_bits);
+
+        // Layer components are registered on behalf of the layer index
+        void build(size_t i);
+        void release(size_t i);
+        void set_layer_sparsity(size_t i, double zero_fraction);
+
+        std::vector<size_t> schedule();
+
+        // Sends the layer's input from the host if it reads the model input, then simulates it
+        void run(size_t i);
+
+        // Residency and finish times from the layer delays
+        void layout(const std::vector<size_t>& order);
+
     public:
         Model(const std::array<uint32_t, 3>& input_size, uint32_t cs, Host* h, Interconnect* ic);
-    
-        Model& Conv(uint32_t kh, uint32_t kw, uint32_t filters, uint32_t stride = 1, uint32_t pad = 0, const std::string& act = "relu");
-    
+
+        // weight_bits and act_bits give the layer its own weight and output
+        // precision, 0 keeps the bit precision of the interconnect
+        Model& Conv(uint32_t kh, uint32_t kw, uint32_t filters, uint32_t stride = 1, uint32_t pad = 0, const std::string& act = "relu",
+                    uint32_t weight_bits = 0, uint32_t act_bits = 0);
+
         Model& MaxPool(uint32_t ph, uint32_t pw);
-    
+
         Model& Flatten();
-    
-        Model& Dense(uint32_t out_features, const std::string& act = "relu");
-    
+
+        Model& Dense(uint32_t out_features, const std::string& act = "relu", uint32_t weight_bits = 0, uint32_t act_bits = 0);
+
+        // Element-wise sum of equally shaped tensors (residual connections)
+        Model& Add(const std::vector<std::string>& inputs);
+
+        // Channel-wise concatenation of tensors with equal height and width
+        Model& Concat(const std::vector<std::string>& inputs);
+
+        // Product of two tensors of tokens (height x width) with channel features,
+        // the second written into the crossbars on every run: inputs[0]·inputs[1],
+        // or inputs[0]·inputs[1]ᵀ with transpose. heads splits the features of
+        // inputs[0] into independent products; "softmax" normalizes every output row.
+        Model& MatMul(const std::vector<std::string>& inputs, bool transpose = false, uint32_t heads = 1, const std::string& act = "none");
+
+        // Self-attention over the tokens of the current tensor: Q, K and V
+        // projections, softmax(Q·Kᵀ)·V per head and the output projection
+        Model& MultiHeadAttention(uint32_t heads);
+
+        // Fraction of zeros in the last layer's output (e.g. after ReLU)
+        Model& Sparsity(double zero_fraction);
+
+        // Continue building from a named tensor (starts a new branch)
+        Model& From(const std::string& tensor);
+
+        // Name the output of the last layer so later layers can refer to it
+        Model& As(const std::string& tensor);
+
+        // Physical crossbars shared by all layers, layers that do not fit are reprogrammed on use
+        void set_crossbar_pool(uint32_t crossbars);
+
         void forward();
 
+        // What-if edit after forward(): output sparsity of the layer producing the tensor
+        void set_sparsity(const std::string& tensor, double zero_fraction);
+
+        // Re-simulates only the layers touched by edits since the last run, see
+        // Interconnect::setTracking(), and lays out the timeline again.
+        // Returns the number of layers simulated.
+        uint32_t update();
+
         uint32_t get_delay();
-    
-        ~Model();
-    };
\ No newline at end of file
+        uint32_t get_crossbar_pool();
+        uint32_t get_resident_num();
+        uint64_t get_program_delay();
+        uint64_t get_programmed_bits();
+        // Summed over the layers, see PIPELINE_DEPTH
+        uint64_t get_overlap_saved();
+
+        // Host DRAM transfers of the model input and output over all timesteps, see DRAM_BW
+        uint64_t get_input_load();
+        uint64_t get_output_drain();
+        uint64_t get_input_bits();
+        uint64_t get_output_bits();
+
+        // Layers from the model input to the output written last, each with
+        // the input it waited for
+        std::vector<PathStep> get_critical_path();
+        const CriticalInput& get_critical_output();
+        const LayerSummary& get_summary(size_t layer);
+
+        // SNN mode: latency of one timestep and the time between two, see SNN_TIMESTEPS
+        uint32_t get_timestep_delay();
+        uint32_t get_timestep_interval();
+        // Time the slowest layer is busy with one input; inputs streamed
+        // through the layers enter one per interval, so it bounds throughput
+        uint32_t get_initiation_interval();
+
+        // Output buffer of a layer, nullptr without one
+        Buffer* get_buffer(size_t layer);
+        uint32_t get_buffer_stall(size_t layer);
+        size_t get_layer_num();
+        // Weight bits and output planes of a layer, and whether any layer was given its own
+        LayerPrecision get_precision(size_t layer);
+        bool is_mixed_precision();
+        // Bits all buffers hold from each time on; a buffer fills when its
+        // producer starts and empties when its last consumer finishes
+        const std::vector<std::pair<uint32_t, uint64_t>>& get_buffer_occupancy();
+
+        // Most layers alive at once and the arena bytes of their components, see STREAM_LAYERS
+        size_t get_peak_live_layers();
+        uint64_t get_peak_live_bytes();
+    };
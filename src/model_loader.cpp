@@ -0,0 +1,76 @@
+#include "model_loader.hpp"
+
+ModelDescription parseModelDescription(const JsonValue& root) {
+    ModelDescription description;
+    description.name = root.getString("name", "model");
+
+    const JsonValue& input = root["input"];
+    if (input.size() < 1 || input.size() > 3) {
+        fail("Model input must be [height, width, channel]!");
+    }
+    description.input_size = {1, 1, 1};
+    for (size_t i = 0; i < input.size(); i++) {
+        description.input_size[i] = input[i].asUint();
+    }
+
+    description.layers = root["layers"];
+    if (description.layers.kind != JsonValue::Kind::Array || description.layers.size() == 0) {
+        fail("Model description has no layers!");
+    }
+    return description;
+}
+
+ModelDescription loadModelDescription(const std::string& filename) {
+    return parseModelDescription(parseJsonFile(filename));
+}
+
+static std::vector<std::string> tensorNames(const JsonValue& layer) {
+    std::vector<std::string> names;
+    for (auto& name: layer["inputs"].array) {
+        names.push_back(name.asString());
+    }
+    return names;
+}
+
+void buildModel(const ModelDescription& description, Model& model) {
+    for (auto& layer: description.layers.array) {
+        std::string type = layer.getString("type", "");
+        if (layer.has("input")) {
+            model.From(layer["input"].asString());
+        }
+
+        if (type == "Conv" || type == "Conv2D") {
+            const JsonValue& kernel = layer["kernel"];
+            uint32_t kh = kernel[0].asUint();
+            uint32_t kw = kernel.size() > 1 ? kernel[1].asUint() : kh;
+            model.Conv(kh, kw, layer["filters"].asUint(), layer.getUint("stride", 1), layer.getUint("pad", 0), layer.getString("activation", "relu"),
+                       layer.getUint("weight_bits", 0), layer.getUint("act_bits", 0));
+        } else if (type == "MaxPool" || type == "MaxPooling2D") {
+            const JsonValue& pool = layer["pool"];
+            uint32_t ph = pool[0].asUint();
+            uint32_t pw = pool.size() > 1 ? pool[1].asUint() : ph;
+            model.MaxPool(ph, pw);
+        } else if (type == "Flatten") {
+            model.Flatten();
+        } else if (type == "Dense") {
+            model.Dense(layer["units"].asUint(), layer.getString("activation", "relu"), layer.getUint("weight_bits", 0), layer.getUint("act_bits", 0));
+        } else if (type == "Add") {
+            model.Add(tensorNames(layer));
+        } else if (type == "Concat" || type == "Concatenate") {
+            model.Concat(tensorNames(layer));
+        } else if (type == "MatMul") {
+            model.MatMul(tensorNames(layer), layer.getBool("transpose", false), layer.getUint("heads", 1), layer.getString("activation", "none"));
+        } else if (type == "MultiHeadAttention") {
+            model.MultiHeadAttention(layer.getUint("heads", 1));
+        } else {
+            fail("Unknown layer type: ", type);
+        }
+
+        if (layer.has("sparsity")) {
+            model.Sparsity(layer["sparsity"].asNumber());
+        }
+        if (layer.has("name")) {
+            model.As(layer["name"].asString());
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "model.hpp"
+#include "json.hpp"
+
+// A network topology read from a JSON model description file
+struct ModelDescription {
+    std::string name;
+    std::array<uint32_t, 3> input_size;
+    JsonValue layers;
+};
+
+ModelDescription parseModelDescription(const JsonValue& root);
+
+ModelDescription loadModelDescription(const std::string& filename);
+
+// Replays the layer list on the Model builder
+void buildModel(const ModelDescription& description, Model& model);
@@ -0,0 +1,68 @@
+#include "networks.hpp"
+
+void buildMLP(Model& model, uint32_t hidden) {
+    model.Dense(512)
+        .Dense(hidden)
+        .Dense(10);
+}
+
+void buildCNN(Model& model) {
+    model.Conv(3, 3, 32)
+         .MaxPool(2, 2)
+         .Conv(3, 3, 64)
+         .MaxPool(2, 2)
+         .Conv(3, 3, 64)
+         .Flatten()
+         .Dense(64)
+         .Dense(10);
+}
+
+void buildLeNet5(Model& model) {
+    model.Conv(5, 5, 6, 1, 2)
+         .MaxPool(2, 2)
+         .Conv(5, 5, 16)
+         .MaxPool(2, 2)
+         .Flatten()
+         .Dense(120)
+         .Dense(84)
+         .Dense(10);
+}
+
+void buildVGG16(Model& model) {
+    const uint32_t stages[5][2] = {{2, 64}, {2, 128}, {3, 256}, {3, 512}, {3, 512}};
+    for (auto& stage: stages) {
+        for (uint32_t i = 0; i < stage[0]; i++) model.Conv(3, 3, stage[1], 1, 1);
+        model.MaxPool(2, 2);
+    }
+    model.Flatten()
+         .Dense(4096)
+         .Dense(4096)
+         .Dense(1000);
+}
+
+// Max pooling stands in for the 3x3 stride-2 and the global average pooling
+void buildResNet18(Model& model) {
+    model.Conv(7, 7, 64, 2, 3)
+         .MaxPool(2, 2).As("b0");
+    const uint32_t channels[4] = {64, 128, 256, 512};
+    uint32_t block = 0;
+    for (uint32_t stage = 0; stage < 4; stage++) {
+        for (uint32_t i = 0; i < 2; i++) {
+            std::string in = "b" + std::to_string(block);
+            std::string out = "b" + std::to_string(++block);
+            uint32_t stride = (stage > 0 && i == 0) ? 2 : 1;
+            std::string shortcut = in;
+            if (stride > 1) {
+                shortcut = out + "s";
+                model.From(in).Conv(1, 1, channels[stage], stride).As(shortcut);
+            }
+            model.From(in)
+                 .Conv(3, 3, channels[stage], stride, 1)
+                 .Conv(3, 3, channels[stage], 1, 1).As(out + "y")
+                 .Add({shortcut, out + "y"}).As(out);
+        }
+    }
+    model.MaxPool(7, 7)
+         .Flatten()
+         .Dense(1000);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "simulation.hpp"
+
+// Reference networks shared by main, bench and golden
+
+// 784-512-hidden-10 perceptron
+void buildMLP(Model& model, uint32_t hidden = 32);
+
+// Three 3x3 convolutions with max pooling, then two dense layers
+void buildCNN(Model& model);
+
+void buildLeNet5(Model& model);
+
+void buildVGG16(Model& model);
+
+void buildResNet18(Model& model);
@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "configuration.hpp"
+#include "error.hpp"
+
+// SIM_THREADS, or one worker per core
+inline uint32_t workerNum() {
+    static const uint32_t workers = SIM_THREADS ? SIM_THREADS : std::max(1u, std::thread::hardware_concurrency());
+    return workers;
+}
+
+// Workers for a layer of the given size, small layers stay on the calling thread
+inline uint32_t workersFor(size_t crossbars) {
+    return crossbars >= PARALLEL_CROSSBARS ? workerNum() : 1;
+}
+
+// Threads started once and shared by every parallel stage. One job runs at a
+// time; a job started from a pool thread, or while another one runs, stays on
+// the calling thread.
+class WorkerPool {
+    private:
+    std::mutex job_lock;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(uint32_t)>* task = nullptr;
+    uint32_t task_num = 0, next_task = 0, pending = 0;
+
+    static bool& onPoolThread() {
+        static thread_local bool pool_thread = false;
+        return pool_thread;
+    }
+
+    void loop() {
+        onPoolThread() = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return next_task < task_num; });
+            while (next_task < task_num) {
+                uint32_t t = next_task++;
+                lock.unlock();
+                (*task)(t);
+                lock.lock();
+                if (--pending == 0) done.notify_one();
+            }
+        }
+    }
+
+    explicit WorkerPool(uint32_t threads) {
+        for (uint32_t i = 0; i < threads; i++) std::thread(&WorkerPool::loop, this).detach();
+    }
+
+    public:
+    // The threads are never joined, so the pool lives until the process ends
+    static WorkerPool& get() {
+        static WorkerPool* pool = new WorkerPool(workerNum() - 1);
+        return *pool;
+    }
+
+    // Calls body(t) for every t in [0, count), body(0) on the calling thread
+    void run(uint32_t count, const std::function<void(uint32_t)>& body) {
+        std::unique_lock<std::mutex> job(job_lock, std::defer_lock);
+        if (count <= 1 || onPoolThread() || !job.try_lock()) {
+            for (uint32_t t = 0; t < count; t++) body(t);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &body;
+            task_num = count;
+            next_task = 1;
+            pending = count - 1;
+        }
+        wake.notify_all();
+        body(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        // Takes on the tasks no pool thread has started yet
+        while (next_task < task_num) {
+            uint32_t t = next_task++;
+            lock.unlock();
+            body(t);
+            lock.lock();
+            pending--;
+        }
+        done.wait(lock, [&] { return pending == 0; });
+        task_num = next_task = 0;
+        task = nullptr;
+    }
+};
+
+// Splits [0, count) into one contiguous range per worker and calls
+// body(begin, end, worker) for each, worker 0 on the calling thread. Errors
+// of the workers are raised on the calling thread once all have finished.
+inline void parallelFor(size_t count, uint32_t workers, const std::function<void(size_t, size_t, uint32_t)>& body) {
+    workers = static_cast<uint32_t>(std::min<size_t>(workers, count));
+    if (workers <= 1) {
+        body(0, count, 0);
+        return;
+    }
+    size_t chunk = (count + workers - 1) / workers;
+    uint32_t ranges = static_cast<uint32_t>((count + chunk - 1) / chunk);
+    bool throws = throw_errors;
+    std::vector<std::exception_ptr> errors(ranges);
+    WorkerPool::get().run(ranges, [&](uint32_t worker) {
+        bool previous = throw_errors;
+        throw_errors = throws;
+        try {
+            body(worker * chunk, std::min(count, (worker + 1) * chunk), worker);
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+        throw_errors = previous;
+    });
+    for (auto& error: errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
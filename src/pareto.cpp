@@ -0,0 +1,135 @@
+#include "pareto.hpp"
+
+namespace {
+
+struct Objectives {
+    uint32_t delay;
+    uint32_t crossbars;
+    uint64_t total_bits;
+    uint32_t bandwidth;
+};
+
+Objectives objectives(const DesignPoint& point) {
+    return {point.delay, point.crossbars, point.total_bits, point.config.bandwidth};
+}
+
+bool weaklyDominates(const Objectives& a, const Objectives& b) {
+    return a.delay <= b.delay && a.crossbars <= b.crossbars && a.total_bits <= b.total_bits && a.bandwidth <= b.bandwidth;
+}
+
+bool dominates(const Objectives& a, const Objectives& b) {
+    return weaklyDominates(a, b) && (a.delay < b.delay || a.crossbars < b.crossbars
+        || a.total_bits < b.total_bits || a.bandwidth < b.bandwidth);
+}
+
+class FrontSearch {
+    private:
+    const DesignEvaluator& evaluate;
+    uint32_t& evaluations;
+    std::vector<DesignPoint> points;
+
+    DesignPoint run(SimConfig config, uint32_t bandwidth) {
+        config.bandwidth = bandwidth;
+        config.class_bandwidth.fill(bandwidth);
+        evaluations++;
+        DesignPoint point = evaluate(config);
+        points.push_back(point);
+        return point;
+    }
+
+    bool covered(const Objectives& bound) {
+        for (auto& p: points) {
+            if (weaklyDominates(objectives(p), bound)) return true;
+        }
+        return false;
+    }
+
+    // Delays at bandwidths[low] and bandwidths[high] are known
+    void bisect(const SimConfig& config, const std::vector<uint32_t>& bandwidths, size_t low, size_t high,
+                uint32_t low_delay, const DesignPoint& high_point) {
+        if (high - low < 2 || low_delay == high_point.delay) return;
+        if (covered({high_point.delay, high_point.crossbars, high_point.total_bits, bandwidths[low + 1]})) return;
+        size_t mid = low + (high - low) / 2;
+        DesignPoint mid_point = run(config, bandwidths[mid]);
+        bisect(config, bandwidths, low, mid, low_delay, mid_point);
+        bisect(config, bandwidths, mid, high, mid_point.delay, high_point);
+    }
+
+    public:
+    FrontSearch(const DesignEvaluator& evaluate, uint32_t& evaluations): evaluate(evaluate), evaluations(evaluations) {}
+
+    void group(const SimConfig& config, const std::vector<uint32_t>& bandwidths) {
+        DesignPoint high = run(config, bandwidths.back());
+        points.pop_back();
+        // Best delay this group can reach at its cheapest bandwidth
+        if (covered({high.delay, high.crossbars, high.total_bits, bandwidths.front()})) return;
+        points.push_back(high);
+        if (bandwidths.size() == 1) return;
+        DesignPoint low = run(config, bandwidths.front());
+        bisect(config, bandwidths, 0, bandwidths.size() - 1, low.delay, high);
+    }
+
+    std::vector<DesignPoint> front() {
+        std::vector<DesignPoint> result;
+        for (size_t i = 0; i < points.size(); i++) {
+            bool keep = true;
+            for (size_t j = 0; j < points.size() && keep; j++) {
+                if (dominates(objectives(points[j]), objectives(points[i]))) keep = false;
+            }
+            for (auto& r: result) {
+                if (weaklyDominates(objectives(r), objectives(points[i]))) keep = false;
+            }
+            if (keep) result.push_back(points[i]);
+        }
+        std::sort(result.begin(), result.end(), [](const DesignPoint& a, const DesignPoint& b) { return a.delay < b.delay; });
+        return result;
+    }
+};
+
+}
+
+std::vector<DesignPoint> paretoFront(const DesignSpace& space, const DesignEvaluator& evaluate, uint32_t& evaluations) {
+    std::vector<uint32_t> bandwidths = space.bandwidths;
+    std::sort(bandwidths.begin(), bandwidths.end());
+    evaluations = 0;
+    if (bandwidths.empty()) return {};
+
+    FrontSearch search(evaluate, evaluations);
+    for (uint32_t size: space.crossbar_sizes) {
+        for (uint32_t precision: space.bit_precisions) {
+            if (precision > size) continue;
+            for (uint32_t mapping: space.mappings) {
+                SimConfig config;
+                config.crossbar_size = size;
+                config.bit_precision = precision;
+                config.conv_mapping = mapping;
+                search.group(config, bandwidths);
+            }
+        }
+    }
+    return search.front();
+}
+
+DesignEvaluator designEvaluator(const std::array<uint32_t, 3>& input_size, const std::function<void(Model&)>& build,
+                                LayerCache* cache) {
+    return [input_size, build, cache](const SimConfig& config) {
+        bool traced = isTraced();
+        setTrace(false);
+        DesignPoint point;
+        point.config = config;
+        {
+            Simulation simulation(input_size, "", config, cache);
+            build(simulation.getModel());
+            simulation.getModel().forward();
+            point.delay = simulation.getModel().get_delay();
+            point.crossbars = simulation.getInterconnect().getCrossbarNum();
+            point.total_bits = simulation.getInterconnect().getTotalBits();
+            if (Board* board = simulation.getBoard()) {
+                point.crossbars = board->getCrossbarNum();
+                point.total_bits = board->getTotalBits();
+            }
+        }
+        setTrace(traced);
+        return point;
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <functional>
+#include "simulation.hpp"
+
+// One simulated design and the objectives it is compared on, all minimised
+struct DesignPoint {
+    SimConfig config;
+    uint32_t delay;
+    uint32_t crossbars;
+    uint64_t total_bits;
+};
+
+struct DesignSpace {
+    std::vector<uint32_t> crossbar_sizes;
+    std::vector<uint32_t> bit_precisions;
+    std::vector<uint32_t> bandwidths;       // every port and link class
+    std::vector<uint32_t> mappings;
+};
+
+using DesignEvaluator = std::function<DesignPoint(const SimConfig&)>;
+
+// Pareto front of delay, crossbar count, total bits and bandwidth.
+// Crossbars and bits do not depend on the bandwidth and delay never grows
+// with it, so each size x precision x mapping group is evaluated at its
+// highest bandwidth first and skipped if that bound is already dominated.
+// Otherwise the bandwidth range is bisected and only split where the delay
+// differs at its ends: bandwidths in between cost more for the same delay.
+std::vector<DesignPoint> paretoFront(const DesignSpace& space, const DesignEvaluator& evaluate, uint32_t& evaluations);
+
+// Evaluator that rebuilds the model with build() on a fresh, untraced simulation
+DesignEvaluator designEvaluator(const std::array<uint32_t, 3>& input_size, const std::function<void(Model&)>& build,
+                                LayerCache* cache = nullptr);
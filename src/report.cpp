@@ -0,0 +1,184 @@
+#include "report.hpp"
+#include <fstream>
+
+namespace {
+
+std::string inputName(int input) { return input >= 0 ? "layer " + std::to_string(input) : "host"; }
+
+// The layers the model delay runs through, the slowest send of each of their
+// stages and how much earlier the runner-up inputs and links were done
+void writeCriticalPath(std::ofstream& dotFile, Model& model) {
+    std::vector<PathStep> path = model.get_critical_path();
+    dotFile << "Critical Path: host";
+    for (auto& step: path) dotFile << " -> " << step.layer;
+    dotFile << " -> host\n";
+    for (auto& step: path) {
+        dotFile << "Critical Layer " << step.layer << ": " << step.start << " to " << step.finish
+        << " unit time, waited for " << inputName(step.input);
+        if (step.runner_up != NO_INPUT) dotFile << ", slack " << step.slack << " over " << inputName(step.runner_up);
+        dotFile << "\n";
+        for (auto& send: model.get_summary(step.layer).critical_sends) {
+            if (!send.time) continue;
+            dotFile << "  " << send.stage << ": 0x" << std::hex << send.source << " -> 0x" << send.destination << std::dec
+            << ", " << send.bits << " bits at ";
+            if (send.bandwidth) {
+                dotFile << send.bandwidth << " bits per unit time";
+            } else {
+                dotFile << "the inter-chip link";
+            }
+            dotFile << ", " << send.time << " unit time";
+            if (send.has_runner_up) dotFile << ", slack " << send.time - std::min(send.time, send.runner_up);
+            dotFile << "\n";
+        }
+    }
+    const CriticalInput& output = model.get_critical_output();
+    if (output.runner_up != NO_INPUT) {
+        dotFile << "Output Slack: " << output.slack << " unit time over " << inputName(output.runner_up) << "\n";
+    }
+}
+
+}
+
+void writeReport(const std::string& filename, Interconnect& interconnect, Model& model, std::chrono::microseconds duration,
+                 Board* board, LayerCache* cache) {
+    // A board reports the totals over all of its chips
+    std::vector<Interconnect*> chips = {&interconnect};
+    if (board) {
+        chips.clear();
+        for (uint32_t i = 0; i < board->getChipNum(); i++) chips.push_back(board->getChip(i));
+    }
+    uint32_t crossbar_num = 0, min_bandwidth = 0;
+    double valid_area = 0;
+    uint64_t line_buffer_bits = 0, reuse_bits_saved = 0, multicast_bits_saved = 0, multicast_time_saved = 0;
+    for (auto* chip : chips) {
+        crossbar_num += chip->getCrossbarNum();
+        if (chip->getCrossbarNum()) valid_area += chip->getCrossbarUsage() * chip->getCrossbarNum();
+        min_bandwidth = std::max(min_bandwidth, chip->getMinBandwidth());
+        line_buffer_bits += chip->getLineBufferBits();
+        reuse_bits_saved += chip->getReuseBitsSaved();
+        multicast_bits_saved += chip->getMulticastBitsSaved();
+        multicast_time_saved += chip->getMulticastTimeSaved();
+    }
+    uint64_t total_bits = board ? board->getTotalBits() : interconnect.getTotalBits();
+    uint64_t raw_bits = board ? board->getRawBits() : interconnect.getRawBits();
+
+    std::ofstream dotFile;
+    dotFile.open(filename);
+    dotFile << "Crossbar Size: " << interconnect.getConfig().crossbar_size << "*" << interconnect.getConfig().crossbar_size << "\n"
+    << "Bit Precision: " << interconnect.getConfig().bit_precision << "\n"
+    << "Crossbar Amount: " << crossbar_num << "\n"
+    << "Crossbar Usage Proportion: " << valid_area / crossbar_num << "\n"
+    << "Bandwidth: " << interconnect.getConfig().bandwidth << " bits per unit time\n"
+    << "Required Minimum Bandwidth: " << min_bandwidth << " bits per unit time\n"
+    << "Delay: " << model.get_delay() << " unit time\n"
+    << "Total Bits transferred: " << total_bits << " bits\n";
+    if (raw_bits != total_bits) {
+        dotFile << "Link Encoding: " << interconnect.getEncoding().getType() << "\n"
+        << "Raw Bits transferred: " << raw_bits << " bits\n";
+    }
+    if (line_buffer_bits) {
+        dotFile << "Line Buffer Capacity: " << line_buffer_bits << " bits\n"
+        << "Im2col Bits Saved: " << reuse_bits_saved << " bits\n";
+    }
+    if (MULTICAST) {
+        dotFile << "Multicast Bits Saved: " << multicast_bits_saved << " bits\n"
+        << "Multicast Time Saved: " << multicast_time_saved << " unit time summed over the messages\n";
+        if (BUFFER_BITS) dotFile << "Multicast: off between layers, their outputs are read from the buffers\n";
+    }
+    if (PIPELINE_DEPTH) {
+        dotFile << "Pipeline Buffer Depth: " << PIPELINE_DEPTH << " packet groups\n"
+        << "Layer Overlap Saved: " << model.get_overlap_saved() << " unit time\n";
+    }
+    if (SNN_TIMESTEPS) {
+        dotFile << "SNN Timesteps: " << SNN_TIMESTEPS << ", firing rate " << SNN_FIRING_RATE << "\n"
+        << "Timestep Latency: " << model.get_timestep_delay() << " unit time\n"
+        << "Timestep Interval: " << model.get_timestep_interval() << " unit time\n"
+        << "Spike Traffic: " << total_bits << " bits, " << total_bits / std::max<uint64_t>(SNN_TIMESTEPS, 1) << " bits per timestep\n";
+    }
+    if (DRAM_BW) {
+        dotFile << "Host DRAM: " << DRAM_CHANNELS << " channels, " << DRAM_BW << " bits per unit time each, "
+        << DRAM_BURST_BITS << " bit bursts, " << DRAM_LATENCY << " unit time latency\n"
+        << "Input Load: " << model.get_input_load() << " unit time for " << model.get_input_bits() << " bits\n"
+        << "Output Drain: " << model.get_output_drain() << " unit time for " << model.get_output_bits() << " bits\n";
+    }
+    if (BUFFER_BITS) {
+        uint64_t stalls = 0, peak = 0;
+        for (auto& [time, bits]: model.get_buffer_occupancy()) peak = std::max(peak, bits);
+        dotFile << "Layer Buffer: " << BUFFER_BITS << " bits, " << BUFFER_BANKS << " banks, "
+        << BUFFER_WRITE_BW << "/" << BUFFER_READ_BW << " bits per unit time write/read per bank\n";
+        for (size_t i = 0; i < model.get_layer_num(); i++) {
+            Buffer* buffer = model.get_buffer(i);
+            if (!buffer) continue;
+            stalls += model.get_buffer_stall(i);
+            dotFile << "Layer " << i << " Buffer: " << buffer->getStoredBits() << " bits, "
+            << model.get_buffer_stall(i) << " unit time stall\n";
+        }
+        dotFile << "Buffer Stalls: " << stalls << " unit time\n"
+        << "Peak Buffer Occupancy: " << peak << " bits\n";
+        for (auto& [time, bits]: model.get_buffer_occupancy()) {
+            dotFile << "Buffer Occupancy at " << time << ": " << bits << " bits\n";
+        }
+    }
+    if (model.is_mixed_precision()) {
+        for (size_t i = 0; i < model.get_layer_num(); i++) {
+            LayerPrecision precision = model.get_precision(i);
+            const LayerWeights& weights = model.get_summary(i).weights;
+            dotFile << "Layer " << i << " Precision: ";
+            if (weights.crossbars) dotFile << precision.weight_bits << "-bit weights, ";
+            dotFile << precision.act_bits << "-bit activations, " << weights.crossbars << " crossbars, "
+            << weights.delay << " unit time\n";
+        }
+    }
+    uint32_t dynamic_layers = 0, write_delay = 0;
+    uint64_t written_bits = 0;
+    for (size_t i = 0; i < model.get_layer_num(); i++) {
+        const LayerSummary& summary = model.get_summary(i);
+        if (!summary.write_delay) continue;
+        dynamic_layers++;
+        written_bits += summary.weights.bits;
+        write_delay += summary.write_delay;
+    }
+    if (dynamic_layers) {
+        dotFile << "Dynamic Weights: " << dynamic_layers << " layers rewrite " << written_bits << " bits per run in "
+        << write_delay << " unit time\n";
+    }
+    if (model.get_crossbar_pool()) {
+        dotFile << "Crossbar Pool: " << model.get_crossbar_pool() << "\n"
+        << "Resident Layers: " << model.get_resident_num() << "\n"
+        << "Weight Programming: " << WRITE_BW << " bits per unit time, " << ROW_PROGRAM_LATENCY << " unit time per row\n"
+        << "Reprogramming Delay: " << model.get_program_delay() << " unit time\n"
+        << "Reprogrammed Bits: " << model.get_programmed_bits() << " bits\n";
+    }
+    if (board) {
+        dotFile << "\n"
+        << "Chips Used: " << board->getUsedChipNum() << "/" << board->getChipNum() << "\n"
+        << "Crossbars per Chip: " << CHIP_CROSSBARS << "\n"
+        << "Inter-chip Link: " << CHIP_LINK_BW << " bits per unit time, " << CHIP_LINK_LATENCY << " unit time latency\n"
+        << "Inter-chip Bits transferred: " << board->getInterChipBits() << " bits in " << board->getInterChipTransfers() << " transfers\n";
+        for (uint32_t i = 0; i < board->getChipNum(); i++) {
+            Interconnect* chip = board->getChip(i);
+            if (!chip->getCrossbarNum()) continue;
+            dotFile << "Chip " << i << ": " << chip->getCrossbarNum() << " crossbars, usage " << chip->getCrossbarUsage()
+            << ", " << chip->getTotalBits() << " on-chip bits\n";
+        }
+        for (uint32_t i = 0; i < board->getChipNum(); i++) {
+            for (uint32_t j = 0; j < board->getChipNum(); j++) {
+                if (board->getLinkBits(i, j)) {
+                    dotFile << "Link " << i << " -> " << j << ": " << board->getLinkBits(i, j) << " bits\n";
+                }
+            }
+        }
+    }
+    dotFile << "\n";
+    writeCriticalPath(dotFile, model);
+    if (STREAM_LAYERS) {
+        dotFile << "Streamed Layers: " << model.get_layer_num() << ", at most " << model.get_peak_live_layers()
+        << " alive with " << model.get_peak_live_bytes() << " bytes of components\n";
+    }
+    if (cache) {
+        dotFile << "Layer Cache: " << cache->getHits() << " hits in " << cache->getLookups() << " lookups\n";
+    }
+    dotFile << "\n"
+    << "Sim Time Cost: " << duration.count() << "e-6 s\n";
+    dotFile.close();
+}
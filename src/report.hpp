@@ -0,0 +1,8 @@
+#pragma once
+#include <chrono>
+#include "model.hpp"
+#include "board.hpp"
+
+// Text summary of one simulation; a board reports the totals over all of its chips
+void writeReport(const std::string& filename, Interconnect& interconnect, Model& model, std::chrono::microseconds duration,
+                 Board* board = nullptr, LayerCache* cache = nullptr);
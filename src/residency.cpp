@@ -0,0 +1,88 @@
+#include "residency.hpp"
+#include "error.hpp"
+#include <iostream>
+#include <limits>
+
+namespace {
+
+uint64_t ceilDiv(uint64_t a, uint64_t b) {
+    return (a + b - 1) / b;
+}
+
+Residency shared(const LayerWeights& layer, uint32_t free_crossbars, uint32_t write_bw, uint32_t row_latency) {
+    Residency r;
+    if (layer.crossbars == 0) return r;
+    r.resident = false;
+    r.passes = ceilDiv(layer.crossbars, free_crossbars);
+    r.program_delay = programDelay(ceilDiv(layer.bits, r.passes), layer.rows, write_bw, row_latency);
+    return r;
+}
+
+}
+
+uint64_t programDelay(uint64_t bits, uint32_t rows, uint32_t write_bw, uint32_t row_latency) {
+    return ceilDiv(bits, write_bw) + static_cast<uint64_t>(rows) * row_latency;
+}
+
+uint64_t residencyOverhead(const LayerWeights& layer, const Residency& residency) {
+    if (residency.resident) return 0;
+    return static_cast<uint64_t>(residency.passes) * residency.program_delay
+        + static_cast<uint64_t>(residency.passes - 1) * layer.delay;
+}
+
+std::vector<Residency> planResidency(const std::vector<LayerWeights>& layers, uint32_t pool_size, uint32_t write_bw, uint32_t row_latency) {
+    std::vector<Residency> plan(layers.size());
+    uint64_t total = 0;
+    for (auto& l : layers) total += l.crossbars;
+    if (pool_size == 0 || total <= pool_size) return plan;
+
+    if (write_bw == 0) {
+        fail("Write bandwidth must be positive!");
+    }
+
+    // take[i][c]: layer i is resident in the best set of capacity c over layers 0..i
+    size_t n = layers.size();
+    std::vector<uint64_t> best(pool_size, 0);
+    std::vector<std::vector<char>> take(n, std::vector<char>(pool_size, 0));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t value = shared(layers[i], std::max(layers[i].crossbars, 1u), write_bw, row_latency).program_delay;
+        for (int64_t c = static_cast<int64_t>(pool_size) - 1; c >= layers[i].crossbars; c--) {
+            if (best[c - layers[i].crossbars] + value > best[c]) {
+                best[c] = best[c - layers[i].crossbars] + value;
+                take[i][c] = 1;
+            }
+        }
+    }
+
+    // At least one crossbar stays free for the time-shared layers
+    uint64_t best_overhead = std::numeric_limits<uint64_t>::max();
+    std::vector<char> resident(n, 0);
+    for (uint32_t capacity = 0; capacity < pool_size; capacity++) {
+        std::vector<char> chosen(n, 0);
+        uint32_t c = capacity, used = 0;
+        for (size_t i = n; i-- > 0;) {
+            if (take[i][c]) {
+                chosen[i] = 1;
+                c -= layers[i].crossbars;
+                used += layers[i].crossbars;
+            }
+        }
+        uint64_t overhead = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!chosen[i]) overhead += residencyOverhead(layers[i], shared(layers[i], pool_size - used, write_bw, row_latency));
+        }
+        if (overhead < best_overhead) {
+            best_overhead = overhead;
+            resident = chosen;
+        }
+    }
+
+    uint32_t used = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (resident[i]) used += layers[i].crossbars;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!resident[i]) plan[i] = shared(layers[i], pool_size - used, write_bw, row_latency);
+    }
+    return plan;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Weights of one layer as seen by the crossbar pool
+struct LayerWeights {
+    uint32_t crossbars;
+    uint64_t bits;      // programmed cells
+    uint32_t rows;      // rows written per crossbar, the crossbars of a pass are written in parallel
+    uint32_t delay;     // compute delay of one pass
+};
+
+struct Residency {
+    bool resident = true;
+    uint32_t passes = 1;            // tiles the layer is split into when the shared region is too small
+    uint32_t program_delay = 0;     // time to write the weights of one pass
+};
+
+// Time to write bits into crossbars of at most rows rows, written in parallel
+uint64_t programDelay(uint64_t bits, uint32_t rows, uint32_t write_bw, uint32_t row_latency);
+
+// Chooses which layers keep their weights in a pool of pool_size crossbars.
+// The others time-share the remaining crossbars and are rewritten every time
+// they run. Layers are picked by a 0/1 knapsack on their programming time and
+// the resident set with the smallest total reprogramming overhead is kept.
+std::vector<Residency> planResidency(const std::vector<LayerWeights>& layers, uint32_t pool_size, uint32_t write_bw, uint32_t row_latency);
+
+// Time one non-resident layer adds to the timeline
+uint64_t residencyOverhead(const LayerWeights& layer, const Residency& residency);
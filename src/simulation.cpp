@@ -0,0 +1,30 @@
+#include "simulation.hpp"
+
+Simulation::Simulation(const std::array<uint32_t, 3>& input_size, const std::string& dot_file, const SimConfig& config, LayerCache* cache) {
+    if (!config.crossbar_size || !config.bit_precision || !config.bandwidth) {
+        fail("Crossbar size, bit precision and bandwidth must be positive!");
+    }
+    if (config.crossbar_size < config.bit_precision) {
+        fail("Crossbar size ", config.crossbar_size, " cannot hold a ", config.bit_precision, "-bit weight!");
+    }
+    for (uint32_t bandwidth: config.class_bandwidth) {
+        if (!bandwidth) fail("Link class bandwidths must be positive!");
+    }
+    if (CHIP_NUM > 1) {
+        board.reset(new Board(CHIP_NUM, CHIP_CROSSBARS, CHIP_LINK_BW, CHIP_LINK_LATENCY, dot_file));
+        for (uint32_t i = 0; i < board->getChipNum(); i++) board->getChip(i)->setConfig(config);
+        interconnect = board->getChip(0);
+    } else {
+        single_chip.reset(new Interconnect(dot_file));
+        single_chip->setConfig(config);
+        single_chip->setLayerCache(cache);
+        interconnect = single_chip.get();
+    }
+    host.reset(new Host(64*1024*8, interconnect));
+    interconnect->registerComponent(host.get());
+    model.reset(new Model(input_size, config.crossbar_size, host.get(), interconnect));
+}
+
+Model& Simulation::getModel() { return *model; }
+Interconnect& Simulation::getInterconnect() { return *interconnect; }
+Board* Simulation::getBoard() { return board.get(); }
@@ -0,0 +1,26 @@
+#pragma once
+#include <array>
+#include <memory>
+#include "model.hpp"
+#include "board.hpp"
+
+// One simulated system: a single interconnect, or a board when CHIP_NUM > 1,
+// with the host and an empty model ready to be built
+class Simulation {
+    private:
+    std::unique_ptr<Board> board;
+    std::unique_ptr<Interconnect> single_chip;
+    Interconnect* interconnect;
+    std::unique_ptr<Host> host;
+    std::unique_ptr<Model> model;
+
+    public:
+    // An empty dot_file disables the network graph. The layer cache is not
+    // used on a board, where layer results depend on the chip placement.
+    Simulation(const std::array<uint32_t, 3>& input_size, const std::string& dot_file,
+               const SimConfig& config = SimConfig(), LayerCache* cache = nullptr);
+
+    Model& getModel();
+    Interconnect& getInterconnect();
+    Board* getBoard();
+};